@@ -1,11 +1,51 @@
 import express from "express";
 import path from "path";
-import crypto from "crypto";
 import childProcess from "child_process";
-import fs from "fs";
+import readline from "readline";
 const app = express();
 const port = 3000;
 
+// One `eval --worker` serves all the requests, answering them in order.
+const evalBin = path.resolve(__dirname, "..", "eval");
+const problemsDir = path.resolve(__dirname, "..", "..", "problems");
+let evalWorker: childProcess.ChildProcess | null = null;
+const evalCallbacks: ((result: any) => void)[] = [];
+
+// Fails all the pending requests, if the worker is still the current one.
+function stopEvalWorker(worker: childProcess.ChildProcess, message: string) {
+    if (evalWorker !== worker) {
+        return;
+    }
+    evalWorker = null;
+    worker.kill();
+    evalCallbacks.splice(0).forEach((callback) => callback({ error: message }));
+}
+
+function startEvalWorker(): childProcess.ChildProcess {
+    const worker = childProcess.spawn(evalBin, ["--worker", problemsDir], { stdio: ["pipe", "pipe", "inherit"] });
+    readline.createInterface({ input: worker.stdout! }).on("line", (line) => {
+        let result: any;
+        try {
+            result = JSON.parse(line);
+        } catch (e) {
+            result = { error: `Invalid answer from the eval worker: ${line}` };
+        }
+        evalCallbacks.shift()?.(result);
+    });
+    worker.on("error", (err) => stopEvalWorker(worker, `The eval worker has failed: ${err.message}`));
+    worker.stdin!.on("error", (err) => stopEvalWorker(worker, `The eval worker has failed: ${err.message}`));
+    worker.on("exit", () => stopEvalWorker(worker, "The eval worker has exited."));
+    return worker;
+}
+
+function evaluate(problemId: number, pose: any, callback: (result: any) => void) {
+    if (evalWorker === null) {
+        evalWorker = startEvalWorker();
+    }
+    evalCallbacks.push(callback);
+    evalWorker.stdin!.write(JSON.stringify({ problem: problemId, pose: pose }) + "\n");
+}
+
 app.use(express.json())
 app.use(express.urlencoded({ extended: true }));
 app.use("/problems", express.static(path.resolve(__dirname, "..", "..", "problems")));
@@ -27,16 +67,9 @@ app.get("/", (req, res) => {
     `);
 });
 app.post("/solutions/eval/:id", (req, res) => {
-    const problemId: string = req.params.id;
-    const problemFile =
-        path.resolve(__dirname, "..", "..", "problems", `${("00" + String(problemId)).substr(-3)}.problem`);
-    const solution = JSON.stringify(req.body);
-    const solutionFile =
-        path.resolve("/tmp", crypto.createHash("sha256").update(solution).digest("hex"));
-    fs.writeFileSync(solutionFile, solution);
-    const evalBin = path.resolve(__dirname, "..", "eval");
-    const result = JSON.parse(childProcess.execSync(`${evalBin} ${problemFile} ${solutionFile}`).toString());
-    res.json(result);
+    evaluate(Number(req.params.id), req.body, (result) => {
+        res.status("error" in result ? 500 : 200).json(result);
+    });
 });
 
 app.listen(port, () => {
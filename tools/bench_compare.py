@@ -0,0 +1,85 @@
+import csv
+import statistics
+import sys
+
+# Compares two outputs of `SOLVER --bench` (see yuizumi/bench.h):
+#
+#   python3 bench_compare.py BASELINE.csv NEW.csv [THRESHOLD]
+#
+# Exits with 1 if the valid poses per second drop by more than THRESHOLD
+# (0.1 by default), or if any problem gets fewer valid runs or a worse
+# median of the best dislikes.
+
+
+def load(path):
+    runs = {}
+    with open(path, 'r') as fp:
+        for row in csv.DictReader(fp):
+            runs.setdefault((row['solver'], row['problem']), []).append(row)
+    return runs
+
+
+def summarize(rows):
+    best = [int(r['best_dislikes']) for r in rows if r['best_dislikes']]
+    first = [float(r['first_valid_sec']) for r in rows if r['first_valid_sec']]
+    return {
+        'valid_per_sec': statistics.mean(float(r['valid_per_sec']) for r in rows),
+        'success_rate': statistics.mean(float(r['success_rate']) for r in rows),
+        'solved': len(best),
+        'best': statistics.median(best) if best else None,
+        'first_valid': statistics.mean(first) if first else None,
+    }
+
+
+def change(old, new, spec):
+    return ' -> '.join('-' if x is None else format(x, spec) for x in (old, new))
+
+
+def main(argv):
+    if len(argv) < 3:
+        print('Usage: bench_compare.py BASELINE NEW [THRESHOLD]', file=sys.stderr)
+        return 2
+
+    base = load(argv[1])
+    new = load(argv[2])
+    threshold = float(argv[3]) if len(argv) > 3 else 0.1
+
+    fields = ['solver', 'problem', 'valid_per_sec', 'ratio', 'success_rate',
+              'solved', 'best', 'first_valid', 'verdict']
+    writer = csv.DictWriter(sys.stdout, fields)
+    writer.writeheader()
+
+    regressed = False
+
+    for key in sorted(base.keys() & new.keys()):
+        b = summarize(base[key])
+        n = summarize(new[key])
+        ratio = (n['valid_per_sec'] / b['valid_per_sec']
+                 if b['valid_per_sec'] > 0 else None)
+
+        verdict = 'ok'
+        if ratio is not None and ratio < 1.0 - threshold:
+            verdict = 'slower'
+        if n['solved'] < b['solved']:
+            verdict = 'fewer valid'
+        elif b['best'] is not None and n['best'] is not None and n['best'] > b['best']:
+            verdict = 'worse dislikes'
+        regressed = regressed or verdict != 'ok'
+
+        writer.writerow({
+            'solver': key[0],
+            'problem': key[1],
+            'valid_per_sec': change(b['valid_per_sec'], n['valid_per_sec'], '.1f'),
+            'ratio': f'{ratio:.3f}' if ratio is not None else '',
+            'success_rate': change(b['success_rate'], n['success_rate'], '.3f'),
+            'solved': change(b['solved'], n['solved'], 'd'),
+            'best': change(b['best'], n['best'], '.0f'),
+            'first_valid': change(b['first_valid'], n['first_valid'], '.4f'),
+            'verdict': verdict,
+        })
+
+    return 1 if regressed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -21,8 +21,9 @@ tmp = open(tmpPath, 'w')
 tmp.write(newSolution)
 tmp.close()
 
-oldDislikes = json.loads(subprocess.run("../yuizumi/eval {} {}".format(sys.argv[1], path), shell=True, stdout=PIPE, text=True).stdout)["dislikes"]
-newDislikes = json.loads(subprocess.run("../yuizumi/eval {} {}".format(sys.argv[1], tmpPath), shell=True, stdout=PIPE, text=True).stdout)["dislikes"]
+results = subprocess.run("../yuizumi/eval --batch {} {} {}".format(sys.argv[1], path, tmpPath), shell=True, stdout=PIPE, text=True).stdout.splitlines()
+oldDislikes = json.loads(results[0])["dislikes"]
+newDislikes = json.loads(results[1])["dislikes"]
 
 if oldDislikes > newDislikes:
     file = open(path, 'w')
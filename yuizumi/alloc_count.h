@@ -0,0 +1,73 @@
+#ifndef YUIZUMI_ALLOC_COUNT_H_
+#define YUIZUMI_ALLOC_COUNT_H_
+
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+// Counts the allocations made by each thread, with -DCOUNT_ALLOCS only, by
+// replacing the global operator new.  Hence this is to be included into one
+// translation unit of the program (as each program here is).
+//
+//   ASSERT_NO_ALLOCS(enabled);  // the rest of the scope must not allocate
+//   UNCOUNTED_ALLOCS();         // except in here, e.g. for a cache
+
+#ifdef COUNT_ALLOCS
+#define ASSERT_NO_ALLOCS(enabled) NoAllocs no_allocs_(enabled)
+#define UNCOUNTED_ALLOCS() UncountedAllocs uncounted_allocs_
+#else
+#define ASSERT_NO_ALLOCS(enabled) (void)0
+#define UNCOUNTED_ALLOCS() (void)0
+#endif
+
+#ifdef COUNT_ALLOCS
+
+namespace impl {
+inline thread_local long num_allocs = 0;
+}  // namespace impl
+
+inline long CountAllocs() { return impl::num_allocs; }
+
+class NoAllocs
+{
+public:
+    explicit NoAllocs(bool enabled) : enabled_(enabled), before_(CountAllocs()) {}
+    ~NoAllocs() { assert(!enabled_ || CountAllocs() == before_); }
+
+private:
+    const bool enabled_;
+    const long before_;
+};
+
+class UncountedAllocs
+{
+public:
+    UncountedAllocs() : before_(CountAllocs()) {}
+    ~UncountedAllocs() { impl::num_allocs = before_; }
+
+private:
+    const long before_;
+};
+
+// None inlined, or GCC takes malloc() and free() for mismatches with operator
+// delete and new.
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+    ++impl::num_allocs;
+    if (void* p = std::malloc(size != 0 ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#endif  // COUNT_ALLOCS
+
+#endif  // YUIZUMI_ALLOC_COUNT_H_
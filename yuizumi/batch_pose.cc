@@ -0,0 +1,298 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "v2.h"
+#include "poser.h"
+#include "problem_cache.h"
+
+namespace {
+
+using namespace std;
+
+
+//------------------------
+//  Parameters
+
+// Number of poses each work unit tries.
+constexpr int kPosesPerUnit = 20;
+
+
+//------------------------
+//  Utility
+
+string GetPath(const char* format, int id)
+{
+    char path[64];
+    snprintf(path, sizeof(path), format, id);
+    return path;
+}
+
+optional<Json> LoadJson(const string& filename)
+{
+    ifstream fin(filename);
+    if (!fin) return nullopt;
+    Json json;
+    fin >> json;
+    return json;
+}
+
+// Prefers the cache built by build_cache into ../cache/, unless stale.
+shared_ptr<const Problem> LoadProblem(int id)
+{
+    const string source = GetPath("../problems/%03d.problem", id);
+    if (auto prob = LoadProblemCache(GetPath("../cache/%03d.cache", id), source))
+        return prob;
+
+    const optional<Json> json = LoadJson(source);
+    if (!json.has_value()) return nullptr;
+    return shared_ptr<const Problem>(new Problem(Problem::FromJson(*json)));
+}
+
+
+//------------------------
+//  ThreadPool
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int size);
+    ~ThreadPool();
+
+    void Post(function<void(int)> task);
+
+    // Waits until no task is queued or running.
+    void Wait();
+
+private:
+    void Run(int index);
+
+    mutex mutex_;
+    condition_variable ready_;
+    condition_variable idle_;
+    queue<function<void(int)>> tasks_;
+    int running_ = 0;
+    bool closed_ = false;
+    vector<thread> threads_;
+};
+
+ThreadPool::ThreadPool(int size)
+{
+    for (int i = 0; i < size; i++) threads_.emplace_back([this, i] { Run(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        closed_ = true;
+    }
+    ready_.notify_all();
+    for (thread& t : threads_) t.join();
+}
+
+void ThreadPool::Post(function<void(int)> task)
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        tasks_.push(move(task));
+    }
+    ready_.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    unique_lock<mutex> lock(mutex_);
+    idle_.wait(lock, [&] { return tasks_.empty() && running_ == 0; });
+}
+
+// Each task gets the index of the thread running it.
+void ThreadPool::Run(int index)
+{
+    while (true) {
+        function<void(int)> task;
+        {
+            unique_lock<mutex> lock(mutex_);
+            ready_.wait(lock, [&] { return closed_ || !tasks_.empty(); });
+            if (tasks_.empty()) return;
+            task = move(tasks_.front());
+            tasks_.pop();
+            ++running_;
+        }
+        task(index);
+        {
+            lock_guard<mutex> lock(mutex_);
+            --running_;
+        }
+        idle_.notify_all();
+    }
+}
+
+
+//------------------------
+//  Job
+
+// A problem under work, with one Poser per thread, each seeded apart.
+class Job
+{
+public:
+    Job(int id, shared_ptr<const Problem> prob, const Config& cfg,
+        int num_threads, double budget);
+
+    // Runs one work unit; returns false once the job is over.
+    bool RunUnit(int thread);
+
+    void Save() const;
+
+private:
+    using Clock = chrono::steady_clock;
+
+    const int id_;
+    const shared_ptr<const Problem> shared_prob_;
+    const Problem& prob_;
+    const double budget_;
+
+    vector<unique_ptr<Config>> configs_;
+    vector<unique_ptr<Poser>> posers_;
+
+    mutex mutex_;
+    optional<Clock::time_point> start_;
+    long best_dislikes_ = numeric_limits<long>::max();
+    optional<Pose> best_pose_;
+};
+
+Job::Job(int id, shared_ptr<const Problem> prob, const Config& cfg,
+         int num_threads, double budget)
+    : id_(id), shared_prob_(move(prob)), prob_(*shared_prob_), budget_(budget),
+      posers_(num_threads)
+{
+    for (int i = 0; i < num_threads; i++) {
+        configs_.push_back(make_unique<Config>(cfg));
+        configs_.back()->seed = cfg.seed + i;
+    }
+}
+
+bool Job::RunUnit(int thread)
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (!start_.has_value()) start_ = Clock::now();
+        if (best_dislikes_ == 0) return false;
+        if (chrono::duration<double>(Clock::now() - *start_).count() >= budget_)
+            return false;
+    }
+
+    // Each thread touches only its own Poser.
+    if (posers_[thread] == nullptr) {
+        posers_[thread] = make_unique<Poser>(&prob_, configs_[thread].get());
+    }
+    Poser& poser = *posers_[thread];
+
+    for (int i = 0; i < kPosesPerUnit; i++) {
+        const optional<Pose> pose = poser.MakePose();
+        if (!pose.has_value()) continue;
+
+        const long dislikes = Dislikes(prob_, *pose);
+        lock_guard<mutex> lock(mutex_);
+        if (dislikes < best_dislikes_) {
+            best_dislikes_ = dislikes;
+            best_pose_ = pose;
+        }
+        if (dislikes == 0) break;
+    }
+
+    return true;
+}
+
+// Writes the best pose if it beats the current solution.
+void Job::Save() const
+{
+    if (!best_pose_.has_value()) {
+        cerr << "Problem " << id_ << ": no pose" << endl;
+        return;
+    }
+
+    const string path = GetPath("../solutions/%03d.json", id_);
+    long old_dislikes = numeric_limits<long>::max();
+
+    if (const optional<Json> json = LoadJson(path); json.has_value()) {
+        // A pose of the wrong size (stale or truncated) counts as none.
+        const Pose old_pose = PoseFromJson(*json);
+        if (old_pose.size() == prob_.vertices().size() && Validate(prob_, old_pose))
+            old_dislikes = Dislikes(prob_, old_pose);
+    }
+
+    if (best_dislikes_ < old_dislikes) {
+        ofstream(path) << PoseToJson(*best_pose_) << endl;
+        cout << path << " updated: ";
+        if (old_dislikes == numeric_limits<long>::max()) {
+            cout << "(n/a)";
+        } else {
+            cout << old_dislikes;
+        }
+        cout << " -> " << best_dislikes_ << endl;
+    } else {
+        cerr << "Problem " << id_ << ": " << best_dislikes_ << endl;
+    }
+}
+
+}  // namespace
+
+//------------------------
+//  Entrypoint
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        cerr << "Usage: batch_pose SECONDS ID..." << endl;
+        return 1;
+    }
+
+    const double budget = atof(argv[1]);
+    const int num_threads = max(1u, thread::hardware_concurrency());
+
+    vector<unique_ptr<Job>> jobs;
+
+    for (int i = 2; i < argc; i++) {
+        const int id = atoi(argv[i]);
+        shared_ptr<const Problem> prob = LoadProblem(id);
+        if (prob == nullptr) {
+            cerr << "Problem " << id << ": not found" << endl;
+            continue;
+        }
+
+        Config cfg;
+        const optional<Json> json = LoadJson(GetPath("../search_params/%03d.config", id));
+        if (json.has_value()) cfg = Config::FromJson(*json);
+
+        jobs.push_back(make_unique<Job>(id, move(prob), cfg, num_threads, budget));
+    }
+
+    ThreadPool pool(num_threads);
+
+    // Every unit queues the next one of its job at the back, so the problems
+    // take turns on the threads and all run within the same time budget.
+    function<void(Job*, int)> run = [&](Job* job, int thread) {
+        if (job->RunUnit(thread)) pool.Post([&run, job](int t) { run(job, t); });
+    };
+
+    for (const unique_ptr<Job>& job : jobs) {
+        for (int i = 0; i < num_threads; i++)
+            pool.Post([&run, job = job.get()](int t) { run(job, t); });
+    }
+    pool.Wait();
+
+    for (const unique_ptr<Job>& job : jobs) job->Save();
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+#ifndef YUIZUMI_BENCH_H_
+#define YUIZUMI_BENCH_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string>
+
+// The end-to-end benchmark of a solver, run by its binary given --bench as
+// the first argument:
+//
+//   SOLVER --bench SECONDS NUM_SEEDS PROBLEM...
+//
+// Each problem runs for SECONDS with each of the seeds 1..NUM_SEEDS, which
+// gives one CSV line on stdout.  tools/bench_compare.py compares two of the
+// outputs.
+//
+// The solver passes a function which loads the problem with the seed, and
+// returns another function making one pose and returning its dislikes (or
+// nullopt when it fails).
+
+using MakePoseFunc = std::function<std::optional<long>()>;
+using LoadFunc = std::function<MakePoseFunc(std::istream& in, uint32_t seed)>;
+
+
+//------------------------
+//  Benchmark
+
+namespace impl {
+void RunBenchmark(const char* solver, const std::string& problem,
+                  uint32_t seed, double budget, const MakePoseFunc& make_pose)
+{
+    using Clock = std::chrono::steady_clock;
+
+    long calls = 0, valid = 0;
+    long best = std::numeric_limits<long>::max();
+    double first_valid = -1.0;
+    // Improvements of the best, as "seconds:dislikes" joined with ';'.
+    std::string progress;
+
+    const auto start = Clock::now();
+    double elapsed = 0.0;
+
+    while (elapsed < budget && best != 0) {
+        const std::optional<long> dislikes = make_pose();
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        ++calls;
+        if (!dislikes.has_value()) continue;
+
+        ++valid;
+        if (first_valid < 0.0) first_valid = elapsed;
+        if (*dislikes < best) {
+            best = *dislikes;
+            char buf[64];
+            snprintf(buf, sizeof(buf), "%s%.3f:%ld",
+                     progress.empty() ? "" : ";", elapsed, best);
+            progress += buf;
+        }
+    }
+
+    printf("%s,%s,%u,%.3f,%ld,%ld,%.3f,%.4f,%s,%s,%s\n",
+           solver, problem.c_str(), seed, elapsed, calls, valid,
+           valid / elapsed, (calls > 0) ? static_cast<double>(valid) / calls : 0.0,
+           (valid > 0) ? std::to_string(best).c_str() : "",
+           (valid > 0) ? std::to_string(first_valid).c_str() : "",
+           progress.c_str());
+    fflush(stdout);
+}
+}  // namespace impl
+
+int BenchmarkMain(int argc, char* argv[], const char* solver, const LoadFunc& load)
+{
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s SECONDS NUM_SEEDS PROBLEM...\n", solver);
+        return 1;
+    }
+
+    const double budget = atof(argv[1]);
+    const int num_seeds = atoi(argv[2]);
+
+    printf("solver,problem,seed,seconds,calls,valid,valid_per_sec,success_rate,"
+           "best_dislikes,first_valid_sec,progress\n");
+
+    for (int i = 3; i < argc; i++) {
+        std::string problem = argv[i];
+        problem = problem.substr(problem.find_last_of('/') + 1);
+        problem = problem.substr(0, problem.find('.'));
+
+        for (uint32_t seed = 1; seed <= num_seeds; seed++) {
+            std::ifstream fin(argv[i]);
+            if (!fin) {
+                fprintf(stderr, "%s: not found\n", argv[i]);
+                return 1;
+            }
+            impl::RunBenchmark(solver, problem, seed, budget, load(fin, seed));
+        }
+    }
+
+    return 0;
+}
+
+#endif  // YUIZUMI_BENCH_H_
@@ -0,0 +1,195 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+#include "perf.h"
+#include "v2.h"
+#include "int_pose.h"
+
+namespace {
+
+using namespace std;
+
+
+//------------------------
+//  Timing
+
+// Keeps the compiler from dropping the results.
+volatile long sink;
+
+double min_seconds = 0.05;
+
+// Runs func (doing `ops` operations each time) until min_seconds pass, and
+// returns the nanoseconds per operation.  The counters of perf.h go to phase.
+template <typename Func> double Measure(PerfPhase phase, Func func, int ops)
+{
+    using Clock = chrono::steady_clock;
+
+    long count = 0;
+    const auto start = Clock::now();
+    double elapsed;
+    PERF_START();
+    do {
+        func();
+        count += ops;
+        elapsed = chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < min_seconds);
+    PERF_STOP(phase);
+
+    return elapsed * 1e+9 / count;
+}
+
+void Report(int id, const char* op, int ops, double ns)
+{
+    printf("%03d,%s,%d,%.1f,%.6g\n", id, op, ops, ns, 1e+3 / ns);
+}
+
+
+//------------------------
+//  Inputs
+
+optional<Json> LoadJson(const string& filename)
+{
+    ifstream fin(filename);
+    if (!fin) return nullopt;
+    Json json;
+    fin >> json;
+    return json;
+}
+
+// The segments and points the solvers look at: those of the stored pose,
+// with the same again moved around a little, which are often rejected.
+struct Inputs
+{
+    vector<Complex> points;
+    vector<LineSeg> lines;
+    vector<pair<Circle, Circle>> circles;
+};
+
+Inputs MakeInputs(const Problem& prob, const Pose& pose, mt19937& rng)
+{
+    Inputs inputs;
+    uniform_int_distribution<int> delta(-3, 3);
+
+    const auto jiggle = [&](Complex z) {
+        return z + Complex(delta(rng), delta(rng));
+    };
+
+    for (const Complex z : pose) {
+        inputs.points.push_back(z);
+        inputs.points.push_back(jiggle(z));
+    }
+
+    for (const Edge& e : prob.edges()) {
+        inputs.lines.push_back({pose[e.u], pose[e.v]});
+        inputs.lines.push_back({jiggle(pose[e.u]), jiggle(pose[e.v])});
+    }
+
+    // Where a vertex can go given two of its neighbors, as in hybrid_pose.
+    const vector<Complex>& orig = prob.vertices();
+    vector<vector<int>> adj(orig.size());
+    for (const Edge& e : prob.edges()) {
+        adj[e.u].push_back(e.v);
+        adj[e.v].push_back(e.u);
+    }
+    for (int v = 0; v < orig.size(); v++)
+    for (int i = 0; i < adj[v].size(); i++)
+    for (int j = i + 1; j < adj[v].size(); j++) {
+        const int a = adj[v][i], b = adj[v][j];
+        inputs.circles.emplace_back(Circle{pose[a], abs(orig[a] - orig[v])},
+                                    Circle{pose[b], abs(orig[b] - orig[v])});
+    }
+
+    return inputs;
+}
+
+
+//------------------------
+//  Benchmark
+
+void Run(int id, const Problem& prob, const Pose& pose, mt19937& rng)
+{
+    const Hole& hole = prob.hole();
+    const Inputs inputs = MakeInputs(prob, pose, rng);
+
+    Report(id, "Hole::Hole", 1, Measure(PerfPhase::kHole, [&] {
+        const Hole copy(hole.vertices());
+        sink = copy.xmax();
+    }, 1));
+
+    Report(id, "Contains(Complex)", inputs.points.size(),
+           Measure(PerfPhase::kSearch, [&] {
+        long n = 0;
+        for (const Complex z : inputs.points) n += hole.Contains(z);
+        sink = n;
+    }, inputs.points.size()));
+
+    Report(id, "Contains(LineSeg)", inputs.lines.size(),
+           Measure(PerfPhase::kSearch, [&] {
+        long n = 0;
+        for (const LineSeg& line : inputs.lines) n += hole.Contains(line);
+        sink = n;
+    }, inputs.lines.size()));
+
+    if (!inputs.circles.empty()) {
+        Report(id, "GetIntersections", inputs.circles.size(),
+               Measure(PerfPhase::kSearch, [&] {
+            long n = 0;
+            for (const auto& [c1, c2] : inputs.circles)
+                n += GetIntersections(c1, c2).size();
+            sink = n;
+        }, inputs.circles.size()));
+    }
+
+    Report(id, "Validate", 1, Measure(PerfPhase::kValidate, [&] {
+        sink = Validate(prob, pose);
+    }, 1));
+    const PoseValidator validator(&prob);
+    const IntPose int_pose = ToIntPose(pose);
+    Report(id, "PoseValidator", 1, Measure(PerfPhase::kValidate, [&] {
+        sink = validator.Validate(int_pose);
+    }, 1));
+    Report(id, "Dislikes", 1, Measure(PerfPhase::kDislikes, [&] {
+        sink = Dislikes(prob, pose);
+    }, 1));
+}
+
+}  // namespace
+
+//------------------------
+//  Entrypoint
+
+// Run in yuizumi/, on the problems which have a solution.
+int main(int argc, char* argv[])
+{
+    if (argc >= 2) min_seconds = atof(argv[1]);
+
+    mt19937 rng;
+
+    printf("problem,op,ops,ns_per_op,mops_per_sec\n");
+
+    for (int id = 1; ; id++) {
+        char filename[64];
+        snprintf(filename, sizeof(filename), "../problems/%03d.problem", id);
+        const optional<Json> prob_json = LoadJson(filename);
+        if (!prob_json.has_value()) break;
+
+        snprintf(filename, sizeof(filename), "../solutions/%03d.json", id);
+        const optional<Json> pose_json = LoadJson(filename);
+        if (!pose_json.has_value()) continue;
+
+        const Problem prob = Problem::FromJson(*prob_json);
+        const Pose pose = PoseFromJson(*pose_json);
+        if (pose.size() != prob.vertices().size()) continue;
+
+        Run(id, prob, pose, rng);
+        fflush(stdout);
+    }
+    PERF_REPORT();
+
+    return 0;
+}
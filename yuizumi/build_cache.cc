@@ -0,0 +1,36 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "v2.h"
+#include "problem_cache.h"
+
+// Writes OUT_DIR/NNN.cache for each PROBLEM given as .../NNN.problem.
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::cerr << "Usage: build_cache OUT_DIR PROBLEM..." << std::endl;
+        return 1;
+    }
+
+    const std::string out_dir = argv[1];
+    int status = 0;
+
+    for (int i = 2; i < argc; i++) {
+        std::string name = argv[i];
+        name = name.substr(name.find_last_of('/') + 1);
+        name = name.substr(0, name.find_last_of('.'));
+
+        std::ifstream fin(argv[i]);
+        Json json;
+        fin >> json;
+
+        const Problem prob = Problem::FromJson(json);
+        const std::string filename = out_dir + "/" + name + ".cache";
+        if (!WriteProblemCache(prob, filename)) {
+            std::cerr << filename << ": failed to write" << std::endl;
+            status = 1;
+        }
+    }
+
+    return status;
+}
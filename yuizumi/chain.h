@@ -0,0 +1,248 @@
+#ifndef YUIZUMI_CHAIN_H_
+#define YUIZUMI_CHAIN_H_
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "v2.h"
+
+
+//------------------------
+//  Lattice
+
+// Set of the integer points within the bounding box of the hole.
+class Lattice
+{
+public:
+    explicit Lattice(const Hole& hole)
+        : xmin_(hole.xmin()), ymin_(hole.ymin()),
+          width_(hole.xmax() - hole.xmin() + 1),
+          height_(hole.ymax() - hole.ymin() + 1),
+          bits_((static_cast<size_t>(width_) * height_ + 63) / 64) {}
+
+    bool Get(int x, int y) const
+    {
+        if (x < xmin_ || x >= xmin_ + width_) return false;
+        if (y < ymin_ || y >= ymin_ + height_) return false;
+        const size_t i = Index(x, y);
+        return (bits_[i / 64] >> (i % 64)) & 1;
+    }
+
+    bool Get(Complex z) const
+    {
+        return Get(static_cast<int>(z.real()), static_cast<int>(z.imag()));
+    }
+
+    // The point must be inside the bounding box.
+    void Set(int x, int y)
+    {
+        const size_t i = Index(x, y);
+        bits_[i / 64] |= uint64_t{1} << (i % 64);
+    }
+
+    size_t cells() const { return bits_.size() * 64; }
+
+    template <typename Func> void ForEach(Func func) const
+    {
+        for (size_t k = 0; k < bits_.size(); k++) {
+            for (uint64_t w = bits_[k]; w != 0; w &= w - 1) {
+                const size_t i = k * 64 + __builtin_ctzll(w);
+                func(xmin_ + static_cast<int>(i % width_),
+                     ymin_ + static_cast<int>(i / width_));
+            }
+        }
+    }
+
+private:
+    size_t Index(int x, int y) const
+    {
+        return static_cast<size_t>(y - ymin_) * width_ + (x - xmin_);
+    }
+
+    int xmin_, ymin_, width_, height_;
+    std::vector<uint64_t> bits_;
+};
+
+
+//------------------------
+//  Ring
+
+// Integer offsets (dx, dy) which make a valid length for the edge.
+std::vector<Complex> GetRingOffsets(const Problem& prob, const Edge& edge)
+{
+    const int r = static_cast<int>(std::ceil(std::sqrt(prob.GetMaxNorm(edge))));
+
+    std::vector<Complex> offsets;
+    for (int dy = -r; dy <= r; dy++)
+    for (int dx = -r; dx <= r; dx++) {
+        if (prob.IsValidNorm(edge, dx * dx + dy * dy))
+            offsets.emplace_back(dx, dy);
+    }
+    return offsets;
+}
+
+
+//------------------------
+//  ChainSolver
+
+// Places a path of the figure (v[0], v[1], ..., v[k]) on the lattice, with
+// all edges of valid lengths and inside the hole.
+class ChainSolver
+{
+public:
+    // max_work bounds the number of segments checked in one call of Reach;
+    // max_cells bounds the memory held by the memo.
+    ChainSolver(const Problem* prob, long max_work, size_t max_cells);
+
+    // Returns the points reachable by v[i] for each i, given v[0] is fixed
+    // at the anchor, or nullptr if that takes more than max_work.
+    const std::vector<Lattice>* Reach(const std::vector<int>& path,
+                                      Complex anchor);
+
+    // Places v[1], ..., v[k-1] between v[0] and v[k] already in the pose.
+    // Prefers the hole vertices with the probability of prob_hole.
+    enum class Result { kPlaced, kUnreachable, kTooExpensive };
+    Result Place(const std::vector<int>& path, Pose& pose,
+                 std::mt19937& rng, double prob_hole);
+
+private:
+    const std::vector<Complex>& GetRing(int u, int v);
+
+    // Picks one of the points in the layer connectable with z.
+    bool Pick(const Lattice& layer, int u, int v, Complex z,
+              std::mt19937& rng, double prob_hole, Complex& picked);
+
+    using Key = std::pair<std::vector<int>, std::pair<int, int>>;
+
+    const Problem& prob_;
+    const long max_work_;
+    const size_t max_cells_;
+
+    Lattice hole_vertices_;
+    std::map<std::pair<int, int>, std::vector<Complex>> rings_;
+    std::map<Key, std::vector<Lattice>> memo_;
+    size_t memo_cells_ = 0;
+};
+
+ChainSolver::ChainSolver(const Problem* prob, long max_work, size_t max_cells)
+    : prob_(*prob), max_work_(max_work), max_cells_(max_cells),
+      hole_vertices_(prob_.hole())
+{
+    for (const Complex z : prob_.hole().vertices()) {
+        hole_vertices_.Set(static_cast<int>(z.real()),
+                           static_cast<int>(z.imag()));
+    }
+}
+
+const std::vector<Complex>& ChainSolver::GetRing(int u, int v)
+{
+    const auto key = std::minmax(u, v);
+    auto iter = rings_.find(key);
+    if (iter == rings_.end()) {
+        iter = rings_.emplace(key, GetRingOffsets(prob_, Edge{u, v})).first;
+    }
+    return iter->second;
+}
+
+const std::vector<Lattice>* ChainSolver::Reach(const std::vector<int>& path,
+                                               Complex anchor)
+{
+    const Key key = {path, {static_cast<int>(anchor.real()),
+                            static_cast<int>(anchor.imag())}};
+
+    const auto iter = memo_.find(key);
+    if (iter != memo_.end()) {
+        return iter->second.empty() ? nullptr : &iter->second;
+    }
+
+    const Hole& hole = prob_.hole();
+
+    std::vector<Lattice> layers(1, Lattice(hole));
+    layers[0].Set(key.second.first, key.second.second);
+
+    long work = 0;
+
+    for (int i = 1; i < path.size() && work <= max_work_; i++) {
+        const std::vector<Complex>& ring = GetRing(path[i - 1], path[i]);
+        Lattice next(hole);
+        layers.back().ForEach([&](int x, int y) {
+            if (work > max_work_) return;
+            const Complex z(x, y);
+            for (const Complex dz : ring) {
+                const Complex w = z + dz;
+                if (next.Get(w) || !hole.Contains(w)) continue;
+                ++work;
+                if (hole.Contains(LineSeg{z, w}))
+                    next.Set(static_cast<int>(w.real()),
+                             static_cast<int>(w.imag()));
+            }
+        });
+        layers.push_back(std::move(next));
+    }
+
+    // Remember the failure too, so as not to repeat the same work.
+    if (work > max_work_) layers.clear();
+
+    const size_t cells = layers.empty() ? 0 : layers[0].cells() * layers.size();
+    if (memo_cells_ + cells > max_cells_) {
+        memo_.clear();
+        memo_cells_ = 0;
+    }
+    memo_cells_ += cells;
+
+    const std::vector<Lattice>& result = memo_[key] = std::move(layers);
+    return result.empty() ? nullptr : &result;
+}
+
+bool ChainSolver::Pick(const Lattice& layer, int u, int v, Complex z,
+                       std::mt19937& rng, double prob_hole, Complex& picked)
+{
+    const bool prefer_hole = std::bernoulli_distribution(prob_hole)(rng);
+
+    int count = 0;
+    bool on_hole = false;
+
+    for (const Complex dz : GetRing(u, v)) {
+        const Complex w = z + dz;
+        if (!layer.Get(w)) continue;
+        if (prefer_hole && on_hole && !hole_vertices_.Get(w)) continue;
+        if (!prob_.hole().Contains(LineSeg{w, z})) continue;
+
+        if (prefer_hole && !on_hole && hole_vertices_.Get(w)) {
+            on_hole = true;
+            count = 0;
+        }
+        if (std::uniform_int_distribution<int>(0, count++)(rng) == 0)
+            picked = w;
+    }
+
+    return count > 0;
+}
+
+ChainSolver::Result ChainSolver::Place(const std::vector<int>& path,
+                                       Pose& pose, std::mt19937& rng,
+                                       double prob_hole)
+{
+    const int k = path.size() - 1;
+
+    const std::vector<int> prefix(path.begin(), path.end() - 1);
+    const std::vector<Lattice>* layers = Reach(prefix, pose[path[0]]);
+    if (layers == nullptr) return Result::kTooExpensive;
+
+    for (int i = k - 1; i >= 1; i--) {
+        Complex z;
+        if (!Pick((*layers)[i], path[i], path[i + 1], pose[path[i + 1]],
+                  rng, prob_hole, z)) {
+            // Every point in the layers is reachable from the anchor, so
+            // this can fail only at the end of the path.
+            return Result::kUnreachable;
+        }
+        pose[path[i]] = z;
+    }
+
+    return Result::kPlaced;
+}
+
+#endif  // YUIZUMI_CHAIN_H_
@@ -1,27 +1,123 @@
 #include <algorithm>
 #include <iostream>
-#include "v1.h"
+#include <optional>
+#include <vector>
+#include "v2.h"
 
 using namespace std;
 
-std::optional<Pose> Solve(const Problem& prob)
+// Embeds the figure into the hole vertices, one figure vertex at a time.
+class Embedder
 {
-    const int m = prob.vertices().size();
-    const int n = prob.hole().size();
+public:
+    explicit Embedder(const Problem* prob);
+
+    std::optional<Pose> Solve();
+
+private:
+    bool Solve(int index);
+
+    bool IsFeasible(int v, int i) const;
+
+    const Problem& prob_;
+
+    vector<vector<int>> graph_;
+    vector<int> order_;
+
+    // Squared distances and visibility between the hole vertices.
+    vector<vector<double>> dist_;
+    vector<vector<char>> visible_;
+
+    vector<int> map_;
+    vector<int> used_;
+};
+
+Embedder::Embedder(const Problem* prob)
+    : prob_(*prob),
+      graph_(prob_.vertices().size())
+{
+    for (const Edge& e : prob_.edges()) {
+        graph_[e.u].push_back(e.v);
+        graph_[e.v].push_back(e.u);
+    }
+
+    const Hole& hole = prob_.hole();
+    const int n = hole.size();
+
+    dist_.assign(n, vector<double>(n));
+    visible_.assign(n, vector<char>(n));
+
+    for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++) {
+        dist_[i][j] = norm(hole[i] - hole[j]);
+        visible_[i][j] = hole.Contains(LineSeg{hole[i], hole[j]});
+    }
+
+    // The vertex with the most edges into those ordered already comes next,
+    // then the one with the highest degree.
+    const int m = prob_.vertices().size();
+    vector<int> done(m), links(m);
+
+    while (order_.size() < m) {
+        int v = -1;
+        for (int u = 0; u < m; u++) {
+            if (done[u]) continue;
+            if (v == -1 || links[u] > links[v]
+                || (links[u] == links[v] && graph_[u].size() > graph_[v].size()))
+                v = u;
+        }
+        order_.push_back(v);
+        done[v] = true;
+        for (const int u : graph_[v]) ++links[u];
+    }
+}
+
+std::optional<Pose> Embedder::Solve()
+{
+    const int m = prob_.vertices().size();
+    const int n = prob_.hole().size();
 
     if (m > n) return std::nullopt;
 
-    vector<int> map(n);
-    for (int i = 0; i < n; i++) map[i] = i;
+    map_.assign(m, -1);
+    used_.assign(n, false);
+
+    if (!Solve(0)) return std::nullopt;
 
     Pose pose(m);
-    do {
-        for (int i = 0; i < m; i++) pose[i] = prob.hole().vertices()[map[i]];
-        if (Validate(prob, pose)) return pose;
-        reverse(map.begin() + m, map.end());
-    } while (next_permutation(map.begin(), map.end()));
+    for (int v = 0; v < m; v++) pose[v] = prob_.hole()[map_[v]];
+    return pose;
+}
+
+bool Embedder::Solve(int index)
+{
+    if (index == order_.size()) {
+        return true;
+    }
+
+    const int v = order_[index];
+
+    for (int i = 0; i < prob_.hole().size(); i++) {
+        if (used_[i] || !IsFeasible(v, i)) continue;
+
+        map_[v] = i;
+        used_[i] = true;
+        if (Solve(index + 1)) return true;
+        used_[i] = false;
+        map_[v] = -1;
+    }
+
+    return false;
+}
 
-    return std::nullopt;
+// Whether v can be on the i-th hole vertex with its neighbors mapped so far.
+bool Embedder::IsFeasible(int v, int i) const
+{
+    return all_of(graph_[v].begin(), graph_[v].end(), [&](const int u) {
+        const int j = map_[u];
+        return j == -1
+            || (prob_.IsValidNorm(Edge{u, v}, dist_[i][j]) && visible_[i][j]);
+    });
 }
 
 int main()
@@ -30,10 +126,10 @@ int main()
     cin >> json;
 
     const Problem prob = Problem::FromJson(json);
-    const std::optional<Pose> pose = Solve(prob);
+    const std::optional<Pose> pose = Embedder(&prob).Solve();
     if (pose.has_value()) {
         cout << PoseToJson(*pose) << endl;
-        cerr << "dislikes = " << Evaluate(prob, *pose) << endl;
+        cerr << "dislikes = " << Dislikes(prob, *pose) << endl;
     } else {
         cerr << "dislikes = (n/a)" << endl;
     }
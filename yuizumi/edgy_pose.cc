@@ -1,10 +1,14 @@
 #include <algorithm>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <optional>
 #include <random>
 #include <vector>
 #include "v2.h"
+#include "figure_graph.h"
+#include "hole_table.h"
+#include "bench.h"
 
 namespace {
 
@@ -29,12 +33,14 @@ constexpr int kMaxTotalRetries = 50000;
 class Poser
 {
 public:
-    explicit Poser(const Problem* prob);
+    explicit Poser(const Problem* prob,
+                   uint_fast32_t seed = mt19937::default_seed);
 
     optional<Pose> MakePose() {
         Pose pose(prob_.vertices().size());
         trial_ = 0;
         InitOrder();
+        InitOccupied();
         if (MakePose(pose, 0)) return pose;
         return nullopt;
     }
@@ -44,20 +50,36 @@ private:
 
     void InitXYChooser();
     void InitOrder();
+    void InitOccupied();
 
-    optional<Complex> PickPoint1(const Pose& pose, int v, int u);
-    optional<Complex> PickPoint2(const Pose& pose, int v, int u, int t);
+    void Occupy(int v, Complex z);
+    void Vacate(int v);
+
+    optional<Complex> PickPoint1(const Pose& pose, const Arc& u);
+    optional<Complex> PickPoint2(const Pose& pose, const Arc& u, const Arc& t);
     optional<Complex> PickFromHole(const Pose& pose, int v);
 
     optional<Complex> PickPoint(const Pose& pose, int v);
 
     const Problem& prob_;
+    const FigureGraph graph_;
 
     vector<int> order_;
-    vector<vector<int>> adj_;
+
+    // The neighbors of each vertex placed before it, at the same offsets in
+    // the rows of graph_.
+    vector<Arc> preds_;
+    vector<int> num_preds_;
+
+    Arcs preds(int v) const { return Arcs(&preds_[graph_.offset(v)], num_preds_[v]); }
 
     int trial_;
 
+    HoleTable hole_table_;
+    vector<int> hole_at_;
+    vector<int> occupants_;
+    HoleSet occupied_;
+
     mt19937 rng_;
 
     uniform_int_distribution<int> hole_chooser_;
@@ -67,8 +89,11 @@ private:
 };
 
 // TODO: Initialize rng_ with std::random_device?
-Poser::Poser(const Problem* prob)
+Poser::Poser(const Problem* prob, uint_fast32_t seed)
     : prob_(*prob),
+      graph_(prob),
+      hole_table_(prob),
+      rng_(seed),
       hole_chooser_(0, prob_.hole().size() - 1),
       eps_chooser_(1.0 - prob_.epsilon() / kEpsDivisor,
                    1.0 + prob_.epsilon() / kEpsDivisor),
@@ -79,19 +104,11 @@ Poser::Poser(const Problem* prob)
 void Poser::InitOrder()
 {
     const int n = prob_.vertices().size();
-    vector<vector<int>> adj(n);
-
-    for (const Edge& e : prob_.edges()) {
-        adj[e.u].push_back(e.v);
-        adj[e.v].push_back(e.u);
-    }
 
     order_.resize(n);
-    adj_.resize(n);
-    for (int i = 0; i < n; i++) {
-        adj_[i].clear();
-        order_[i] = i;
-    }
+    for (int i = 0; i < n; i++) order_[i] = i;
+    preds_.resize(graph_.arcs().size());
+    num_preds_.assign(n, 0);
 
     shuffle(order_.begin(), order_.end(), rng_);
 
@@ -99,27 +116,45 @@ void Poser::InitOrder()
 
     for (int i = 0; i < n; i++) {
         const int u = order_[i];
-        for (const int v : adj[u]) { if (!done[v]) adj_[v].push_back(u); }
+        for (const auto [v, e] : graph_.arcs(u)) {
+            if (!done[v]) preds_[graph_.offset(v) + num_preds_[v]++] = {u, e};
+        }
         done[u] = true;
     }
 }
 
-optional<Complex> Poser::PickPoint1(const Pose& pose, const int v, const int u)
+void Poser::InitOccupied()
 {
-    const vector<Complex>& orig = prob_.vertices();
+    hole_at_.assign(prob_.vertices().size(), -1);
+    occupants_.assign(prob_.hole().size(), 0);
+    occupied_ = HoleSet(prob_.hole().size());
+}
 
-    const double dist = sqrt(norm(orig[v] - orig[u]) * eps_chooser_(rng_));
-    return pose[u] + polar(dist, arg_chooser_(rng_));
+void Poser::Occupy(const int v, const Complex z)
+{
+    const int i = hole_table_.Find(z);
+    hole_at_[v] = i;
+    if (i != -1 && occupants_[i]++ == 0) occupied_.Set(i);
 }
 
-optional<Complex> Poser::PickPoint2(const Pose& pose, const int v, const int u,
-                                    const int t)
+void Poser::Vacate(const int v)
 {
-    const vector<Complex>& orig = prob_.vertices();
+    const int i = hole_at_[v];
+    hole_at_[v] = -1;
+    if (i != -1 && --occupants_[i] == 0) occupied_.Reset(i);
+}
+
+optional<Complex> Poser::PickPoint1(const Pose& pose, const Arc& u)
+{
+    const double dist = sqrt(graph_.orig_norm(u.edge) * eps_chooser_(rng_));
+    return pose[u.v] + polar(dist, arg_chooser_(rng_));
+}
 
-    const vector<Complex> zs = GetIntersections(
-        Circle{pose[t], sqrt(norm(orig[v] - orig[t]) * eps_chooser_(rng_))},
-        Circle{pose[u], sqrt(norm(orig[v] - orig[u]) * eps_chooser_(rng_))}
+optional<Complex> Poser::PickPoint2(const Pose& pose, const Arc& u, const Arc& t)
+{
+    const Intersections zs = GetIntersections(
+        Circle{pose[t.v], sqrt(graph_.orig_norm(t.edge) * eps_chooser_(rng_))},
+        Circle{pose[u.v], sqrt(graph_.orig_norm(u.edge) * eps_chooser_(rng_))}
     );
     if (zs.empty()) return nullopt;
 
@@ -131,19 +166,24 @@ optional<Complex> Poser::PickFromHole(const Pose& pose, const int v)
     const int offset = hole_chooser_(rng_);
     const Hole& hole = prob_.hole();
 
+    HoleSet candidates = HoleSet::Full(hole.size());
+    candidates.Subtract(occupied_);
+
+    vector<Arc> others;
+    for (const Arc& w : preds(v)) {
+        if (hole_at_[w.v] != -1)
+            candidates &= hole_table_.Get(w.edge, hole_at_[w.v]);
+        else
+            others.push_back(w);
+    }
+
     for (int i = 0; i < hole.size(); i++) {
+        if (!candidates.Get((i + offset) % hole.size())) continue;
         const Complex z = hole[(i + offset) % hole.size()];
-        bool done = false;
 
-        for (const int j : order_) {
-            if (j == v) break;
-            if (pose[j] == z) { done = true; break; }
-        }
-        if (done) continue;
-
-        const bool verify = all_of(adj_[v].begin(), adj_[v].end(), [&](const int w) {
-            return prob_.IsValidNorm(Edge{v, w}, norm(z - pose[w]))
-                && hole.Contains(LineSeg{pose[w], z});
+        const bool verify = all_of(others.begin(), others.end(), [&](const Arc& w) {
+            return graph_.IsValidNorm(w.edge, norm(z - pose[w.v]))
+                && hole.Contains(LineSeg{pose[w.v], z});
         });
 
         if (verify) return z;
@@ -157,17 +197,20 @@ optional<Complex> Poser::PickPoint(const Pose& pose, const int v)
     optional<Complex> z = PickFromHole(pose, v);
     if (z.has_value()) return z;
 
-    int adj = -1;
+    const Arc* adj = nullptr;
 
-    for (const int u : adj_[v]) {
-        if (adj == -1) {
-            adj = u;
+    for (const Arc& u : preds(v)) {
+        if (adj == nullptr) {
+            adj = &u;
         } else {
-            if (pose[u] != pose[adj]) return PickPoint2(pose, v, u, adj);
+            if (pose[u.v] != pose[adj->v]) return PickPoint2(pose, u, *adj);
         }
     }
 
-    return PickPoint1(pose, v, adj);
+    // Nothing placed next to v, and no room left in the hole.
+    if (adj == nullptr) return nullopt;
+
+    return PickPoint1(pose, *adj);
 }
 
 bool Poser::MakePose(Pose& pose, const int index)
@@ -194,12 +237,17 @@ bool Poser::MakePose(Pose& pose, const int index)
             continue;
         done.push_back(pose[v]);
 
-        const bool verify = all_of(adj_[v].begin(), adj_[v].end(), [&](const int u) {
-            return prob_.IsValidNorm(Edge{u, v}, norm(pose[u] - pose[v]))
-                && prob_.hole().Contains(LineSeg{pose[u], pose[v]});
+        const Arcs adj = preds(v);
+        const bool verify = all_of(adj.begin(), adj.end(), [&](const Arc& u) {
+            return graph_.IsValidNorm(u.edge, norm(pose[u.v] - pose[v]))
+                && prob_.hole().Contains(LineSeg{pose[u.v], pose[v]});
         });
 
-        if (verify && MakePose(pose, index + 1)) return true;
+        if (!verify) continue;
+
+        Occupy(v, pose[v]);
+        if (MakePose(pose, index + 1)) return true;
+        Vacate(v);
     }
 
     return false;
@@ -232,10 +280,29 @@ optional<Pose> Solve(const Problem& prob, int num_poses)
     return best_pose;
 }
 
+// See bench.h.
+MakePoseFunc LoadForBenchmark(istream& in, uint32_t seed)
+{
+    Json json;
+    in >> json;
+    const shared_ptr<const Problem> prob(new Problem(Problem::FromJson(json)));
+    const auto poser = make_shared<Poser>(prob.get(), seed);
+    return [prob, poser]() -> optional<long> {
+        const optional<Pose> pose = poser->MakePose();
+        if (!pose.has_value()) return nullopt;
+        return Dislikes(*prob, *pose);
+    };
+}
+
 }  // namespace
 
 int main(int argc, char* argv[])
 {
+    if (argc >= 2 && string(argv[1]) == "--bench") {
+        return BenchmarkMain(argc - 1, argv + 1, "edgy_pose",
+                             LoadForBenchmark);
+    }
+
     const int num_poses = (argc == 1) ? 1000 : atoi(argv[1]);
     Json json;
     cin >> json;
@@ -1,50 +1,67 @@
 #include <cassert>
+#include <cstdio>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <list>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "v2.h"
+#include "int_pose.h"
+#include "json_reader.h"
 
 namespace {
 
-Json LoadJson(const std::string& filename)
+std::string LoadText(const std::string& filename)
 {
-    Json json;
+    std::ifstream fin;
+    if (filename != "-") fin.open(filename);
+    std::istream& in = (filename == "-") ? std::cin : fin;
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+}
 
-    if (filename == "-") {
-        std::cin >> json;
-    } else {
-        std::ifstream fin(filename);
-        fin >> json;
-        fin.close();
+// Errors of the edge in the pose, as an array.
+Json GetEdgeErrors(const Problem& prob, const Pose& pose, const Edge& e)
+{
+    const std::vector<Complex>& orig = prob.vertices();
+    Json errors = Json::array();
+
+    if (!prob.hole().Contains(LineSeg{pose[e.u], pose[e.v]})) {
+        std::ostringstream msg;
+        msg << "The edge at " << pose[e.u] << "-" << pose[e.v] << " is not "
+            << "inside the hole.";
+        errors.push_back(
+            {{"type", "not_inside_hole"}, {"edge", {e.u, e.v}}, {"message", msg.str()}});
     }
 
-    return json;
+    const double d_pose = norm(pose[e.u] - pose[e.v]);
+    const double d_orig = norm(orig[e.u] - orig[e.v]);
+
+    if (abs(d_pose - d_orig) * kEpsDivisor > prob.epsilon() * d_orig) {
+        std::ostringstream msg;
+        msg << "The edge {" << e.u << ", " << e.v << "} has an invalid length. "
+            << "orig: " << d_orig << ", pose: " << d_pose;
+        errors.push_back(
+            {{"type", "invalid_length"}, {"edge", {e.u, e.v}}, {"message", msg.str()}});
+    }
+
+    return errors;
 }
 
 Json FullValidate(const Problem& prob, const Pose& pose) {
-    const std::vector<Complex>& orig = prob.vertices();
     Json errors = Json::array();
 
     for (const Edge& e : prob.edges()) {
-        if (!prob.hole().Contains(LineSeg{pose[e.u], pose[e.v]})) {
-            std::ostringstream msg;
-            msg << "The edge at " << pose[e.u] << "-" << pose[e.v] << " is not "
-                << "inside the hole.";
-            errors.push_back(
-                {{"type", "not_inside_hole"}, {"edge", {e.u, e.v}}, {"message", msg.str()}});
-        }
-
-        const double d_pose = norm(pose[e.u] - pose[e.v]);
-        const double d_orig = norm(orig[e.u] - orig[e.v]);
-
-        if (abs(d_pose - d_orig) * kEpsDivisor > prob.epsilon() * d_orig) {
-            std::ostringstream msg;
-            msg << "The edge {" << e.u << ", " << e.v << "} has an invalid length. "
-                << "orig: " << d_orig << ", pose: " << d_pose;
-            errors.push_back(
-                {{"type", "invalid_length"}, {"edge", {e.u, e.v}}, {"message", msg.str()}});
-        }
+        for (Json& error : GetEdgeErrors(prob, pose, e))
+            errors.push_back(std::move(error));
     }
 
     Json json = {{"errors", errors}};
@@ -59,17 +76,370 @@ Json FullValidate(const Problem& prob, const Pose& pose) {
     return json;
 }
 
+// The problems used most recently, loaded from the directory on demand.
+class ProblemCache
+{
+public:
+    static constexpr int kCapacity = 16;
+
+    explicit ProblemCache(std::string dir) : dir_(std::move(dir)) {}
+
+    // Sessions keep the problem alive after it is dropped from the cache.
+    std::shared_ptr<const Problem> Get(int id);
+
+private:
+    using Entry = std::pair<int, std::shared_ptr<const Problem>>;
+
+    const std::string dir_;
+
+    // The most recent one comes first.
+    std::list<Entry> entries_;
+    std::unordered_map<int, std::list<Entry>::iterator> index_;
+};
+
+std::shared_ptr<const Problem> ProblemCache::Get(int id)
+{
+    if (const auto iter = index_.find(id); iter != index_.end()) {
+        entries_.splice(entries_.begin(), entries_, iter->second);
+        return entries_.front().second;
+    }
+
+    char filename[32];
+    snprintf(filename, sizeof(filename), "/%03d.problem", id);
+    std::ifstream fin(dir_ + filename);
+    if (!fin) throw std::runtime_error("No such problem: " + std::to_string(id));
+    const std::string text(std::istreambuf_iterator<char>(fin), {});
+
+    entries_.emplace_front(id, new Problem(ReadProblem(text)));
+    index_[id] = entries_.begin();
+
+    if (entries_.size() > kCapacity) {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+    }
+
+    return entries_.front().second;
+}
+
+// A pose under edit.  Moving a vertex checks only the edges at the vertex,
+// and updates the nearest pose vertex of each hole vertex.
+class Session
+{
+public:
+    Session(std::shared_ptr<const Problem> prob, Pose pose);
+
+    // Same as FullValidate.
+    Json GetResult() const;
+
+    // Returns the errors of the edges at the vertex which have changed,
+    // with the dislikes if the pose is valid.
+    Json Move(int v, Complex z);
+
+private:
+    // Finds the nearest pose vertex from the i-th hole vertex.
+    void FindNearest(int i);
+
+    const std::shared_ptr<const Problem> prob_;
+    Pose pose_;
+
+    // Edges at each vertex, by their indices.
+    std::vector<std::vector<int>> incident_;
+
+    std::vector<Json> errors_;
+    int num_invalid_ = 0;
+
+    std::vector<double> nearest_norm_;
+    std::vector<int> nearest_;
+    // Sum of the integers in nearest_norm_, thus exact.
+    double dislikes_ = 0.0;
+};
+
+Session::Session(std::shared_ptr<const Problem> prob, Pose pose)
+    : prob_(std::move(prob)),
+      pose_(std::move(pose)),
+      incident_(pose_.size())
+{
+    const std::vector<Edge>& edges = prob_->edges();
+
+    for (int k = 0; k < edges.size(); k++) {
+        incident_[edges[k].u].push_back(k);
+        incident_[edges[k].v].push_back(k);
+        errors_.push_back(GetEdgeErrors(*prob_, pose_, edges[k]));
+        if (!errors_.back().empty()) ++num_invalid_;
+    }
+
+    const int n = prob_->hole().size();
+    nearest_norm_.resize(n);
+    nearest_.resize(n);
+    for (int i = 0; i < n; i++) {
+        FindNearest(i);
+        dislikes_ += nearest_norm_[i];
+    }
+}
+
+void Session::FindNearest(int i)
+{
+    const Complex zh = prob_->hole()[i];
+    nearest_norm_[i] = kInf;
+    for (int v = 0; v < pose_.size(); v++) {
+        const double d = norm(zh - pose_[v]);
+        if (d < nearest_norm_[i]) {
+            nearest_norm_[i] = d;
+            nearest_[i] = v;
+        }
+    }
+}
+
+Json Session::GetResult() const
+{
+    Json errors = Json::array();
+    for (const Json& edge_errors : errors_) {
+        for (const Json& error : edge_errors) errors.push_back(error);
+    }
+
+    Json json = {{"errors", errors}};
+    if (num_invalid_ == 0) json.emplace("dislikes", static_cast<long>(dislikes_));
+    return json;
+}
+
+Json Session::Move(int v, Complex z)
+{
+    if (v < 0 || v >= pose_.size())
+        throw std::out_of_range("No such vertex: " + std::to_string(v));
+
+    pose_[v] = z;
+
+    Json changes = Json::array();
+    for (const int k : incident_[v]) {
+        Json errors = GetEdgeErrors(*prob_, pose_, prob_->edges()[k]);
+        if (errors == errors_[k]) continue;
+        num_invalid_ += !errors.empty() - !errors_[k].empty();
+        const Edge& e = prob_->edges()[k];
+        changes.push_back({{"edge", {e.u, e.v}}, {"errors", errors}});
+        errors_[k] = std::move(errors);
+    }
+
+    for (int i = 0; i < prob_->hole().size(); i++) {
+        const double d = norm(prob_->hole()[i] - z);
+        const double old = nearest_norm_[i];
+        if (d < old) {
+            nearest_norm_[i] = d;
+            nearest_[i] = v;
+        } else if (nearest_[i] == v && d > old) {
+            FindNearest(i);
+        }
+        dislikes_ += nearest_norm_[i] - old;
+    }
+
+    Json json = {{"changes", changes}};
+    if (num_invalid_ == 0) json.emplace("dislikes", static_cast<long>(dislikes_));
+    return json;
+}
+
+// Answers the requests on stdin, one per line, on stdout:
+//
+//   {"problem": ID, "pose": POSE}  -> the result of FullValidate
+//   {"open": ID, "pose": POSE}     -> {"session": SID} and the result
+//   {"session": SID, "move": V, "to": [X, Y]}
+//                                  -> the changes, see Session::Move()
+//   {"close": SID}                 -> {}
+//
+// Any failure is answered with {"error": MESSAGE}.
+class Worker
+{
+public:
+    explicit Worker(std::string dir) : cache_(std::move(dir)) {}
+
+    void Run();
+
+private:
+    Json Handle(const Json& request);
+
+    Pose GetPose(const Problem& prob, const Json& json) const;
+    Session& GetSession(int sid);
+
+    ProblemCache cache_;
+    std::unordered_map<int, std::unique_ptr<Session>> sessions_;
+    int next_sid_ = 1;
+};
+
+void Worker::Run()
+{
+    for (std::string line; std::getline(std::cin, line); ) {
+        if (line.empty()) continue;
+        Json result;
+        try {
+            result = Handle(Json::parse(line));
+        } catch (const std::exception& e) {
+            result = {{"error", e.what()}};
+        }
+        std::cout << result << std::endl;
+    }
+}
+
+Json Worker::Handle(const Json& request)
+{
+    if (request.contains("problem")) {
+        const auto prob = cache_.Get(request.at("problem").get<int>());
+        return FullValidate(*prob, GetPose(*prob, request.at("pose")));
+    }
+
+    if (request.contains("open")) {
+        const auto prob = cache_.Get(request.at("open").get<int>());
+        auto session = std::make_unique<Session>(
+            prob, GetPose(*prob, request.at("pose")));
+        Json json = session->GetResult();
+        json.emplace("session", next_sid_);
+        sessions_.emplace(next_sid_++, std::move(session));
+        return json;
+    }
+
+    if (request.contains("move")) {
+        Session& session = GetSession(request.at("session").get<int>());
+        const Json& xy = request.at("to");
+        return session.Move(request.at("move").get<int>(),
+                            Complex(xy.at(0).get<int>(), xy.at(1).get<int>()));
+    }
+
+    if (request.contains("close")) {
+        GetSession(request.at("close").get<int>());
+        sessions_.erase(request.at("close").get<int>());
+        return Json::object();
+    }
+
+    throw std::runtime_error("Unknown request.");
+}
+
+Pose Worker::GetPose(const Problem& prob, const Json& json) const
+{
+    Pose pose = PoseFromJson(json);
+    if (pose.size() != prob.vertices().size())
+        throw std::runtime_error("Wrong number of vertices.");
+    return pose;
+}
+
+Session& Worker::GetSession(int sid)
+{
+    const auto iter = sessions_.find(sid);
+    if (iter == sessions_.end())
+        throw std::runtime_error("No such session: " + std::to_string(sid));
+    return *iter->second;
+}
+
+// Evaluates many poses for one problem, giving one line for each.
+class Batch
+{
+public:
+    // Number of poses read from the stream before evaluated together.
+    static constexpr int kChunkSize = 256;
+
+    Batch(const Problem* prob, int num_jobs)
+        : prob_(*prob), num_jobs_(num_jobs), validator_(prob) {}
+
+    void RunFiles(const std::vector<std::string>& filenames);
+    void RunStream(std::istream& in);
+
+private:
+    // Evaluates the poses given as texts, on the jobs in parallel.
+    void Evaluate(const std::vector<std::string>& texts);
+
+    Json Evaluate(const std::string& text) const;
+
+    const Problem& prob_;
+    const int num_jobs_;
+    const PoseValidator validator_;
+};
+
+void Batch::RunFiles(const std::vector<std::string>& filenames)
+{
+    std::vector<std::string> texts;
+    for (const std::string& filename : filenames) texts.push_back(LoadText(filename));
+    Evaluate(texts);
+}
+
+void Batch::RunStream(std::istream& in)
+{
+    std::vector<std::string> texts;
+    for (std::string line; std::getline(in, line); ) {
+        if (line.empty()) continue;
+        texts.push_back(std::move(line));
+        if (texts.size() == kChunkSize) {
+            Evaluate(texts);
+            texts.clear();
+        }
+    }
+    Evaluate(texts);
+}
+
+void Batch::Evaluate(const std::vector<std::string>& texts)
+{
+    std::vector<Json> results(texts.size());
+
+    // The i-th job takes the i-th pose, then every num_jobs_-th after it.
+    const auto run = [&](int i) {
+        for (int k = i; k < texts.size(); k += num_jobs_)
+            results[k] = Evaluate(texts[k]);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_jobs_; i++) threads.emplace_back(run, i);
+    run(0);
+    for (std::thread& t : threads) t.join();
+
+    for (const Json& result : results) std::cout << result << '\n';
+    std::cout << std::flush;
+}
+
+Json Batch::Evaluate(const std::string& text) const
+{
+    try {
+        const Pose pose = ReadPose(text);
+        if (pose.size() != prob_.vertices().size())
+            throw std::runtime_error("Wrong number of vertices.");
+        // The errors are listed for the invalid poses only.
+        if (validator_.Validate(ToIntPose(pose)))
+            return {{"errors", Json::array()}, {"dislikes", Dislikes(prob_, pose)}};
+        return FullValidate(prob_, pose);
+    } catch (const std::exception& e) {
+        return {{"error", e.what()}};
+    }
+}
+
 }  // namespace
 
 int main(int argc, char* argv[])
 {
+    if (argc == 3 && std::string(argv[1]) == "--worker") {
+        Worker(argv[2]).Run();
+        return 0;
+    }
+
+    if (argc >= 3 && std::string(argv[1]) == "--batch") {
+        int arg = 2;
+        int num_jobs = 1;
+        if (std::string(argv[arg]) == "--jobs" && arg + 2 < argc) {
+            num_jobs = std::max(1, atoi(argv[arg + 1]));
+            arg += 2;
+        }
+        const Problem prob = ReadProblem(LoadText(argv[arg++]));
+        Batch batch(&prob, num_jobs);
+        if (arg < argc) {
+            batch.RunFiles(std::vector<std::string>(argv + arg, argv + argc));
+        } else {
+            batch.RunStream(std::cin);
+        }
+        return 0;
+    }
+
     if (argc != 3) {
         std::cerr << "Usage: eval PROBLEM POSE" << std::endl;
+        std::cerr << "       eval --worker PROBLEM_DIR" << std::endl;
+        std::cerr << "       eval --batch [--jobs N] PROBLEM [POSE...]" << std::endl;
         return 1;
     }
 
-    const Problem prob = Problem::FromJson(LoadJson(argv[1]));
-    const Pose pose = PoseFromJson(LoadJson(argv[2]));
+    const Problem prob = ReadProblem(LoadText(argv[1]));
+    const Pose pose = ReadPose(LoadText(argv[2]));
 
     std::cout << FullValidate(prob, pose) << std::endl;
 
@@ -0,0 +1,125 @@
+#ifndef YUIZUMI_FIGURE_GRAPH_H_
+#define YUIZUMI_FIGURE_GRAPH_H_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "v2.h"
+
+
+//------------------------
+//  Arc
+
+// An edge of the figure seen from one end: the other end and the index of
+// the edge in Problem::edges().
+struct Arc { int v; int edge; };
+
+// A contiguous run of arcs.
+class Arcs
+{
+public:
+    Arcs(const Arc* begin, int size) : begin_(begin), size_(size) {}
+
+    const Arc* begin() const { return begin_; }
+    const Arc* end() const { return begin_ + size_; }
+    int size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const Arc& operator[](int i) const { return begin_[i]; }
+
+private:
+    const Arc* begin_;
+    int size_;
+};
+
+
+//------------------------
+//  FigureGraph
+
+// The figure in compressed sparse rows: the arcs out of each vertex stored
+// one vertex after another, in the order of the edges, with the range of
+// valid squared lengths of each edge computed once.
+class FigureGraph
+{
+public:
+    explicit FigureGraph(const Problem* prob);
+
+    int size() const { return offsets_.size() - 1; }
+
+    // The arcs out of v are those at [offset(v), offset(v + 1)) of arcs().
+    const std::vector<Arc>& arcs() const { return arcs_; }
+    int offset(int v) const { return offsets_[v]; }
+    int degree(int v) const { return offsets_[v + 1] - offsets_[v]; }
+    int max_degree() const { return max_degree_; }
+
+    Arcs arcs(int v) const { return Arcs(&arcs_[offsets_[v]], degree(v)); }
+
+    // The index of the edge between u and v, or -1.
+    int FindEdge(int u, int v) const;
+
+    // Same as those of Problem, by the index of the edge.
+    double orig_norm(int e) const { return orig_norms_[e]; }
+    int min_norm(int e) const { return min_norms_[e]; }
+    int max_norm(int e) const { return max_norms_[e]; }
+
+    bool IsValidNorm(int e, double d_pose) const
+    {
+        const double d_orig = orig_norms_[e];
+        return std::abs(d_pose - d_orig) * kEpsDivisor <= epsilon_ * d_orig;
+    }
+
+private:
+    std::vector<int> offsets_;
+    std::vector<Arc> arcs_;
+    int max_degree_ = 0;
+
+    std::vector<double> orig_norms_;
+    std::vector<int> min_norms_;
+    std::vector<int> max_norms_;
+    int epsilon_;
+};
+
+FigureGraph::FigureGraph(const Problem* prob)
+    : epsilon_(prob->epsilon())
+{
+    const std::vector<Complex>& vertices = prob->vertices();
+    const std::vector<Edge>& edges = prob->edges();
+    const int n = vertices.size();
+
+    offsets_.assign(n + 1, 0);
+    for (const Edge& e : edges) {
+        ++offsets_[e.u + 1];
+        ++offsets_[e.v + 1];
+    }
+    for (int v = 0; v < n; v++) {
+        max_degree_ = std::max(max_degree_, offsets_[v + 1]);
+        offsets_[v + 1] += offsets_[v];
+    }
+
+    arcs_.resize(offsets_[n]);
+    std::vector<int> next(offsets_.begin(), offsets_.end() - 1);
+    for (int k = 0; k < edges.size(); k++) {
+        const Edge& e = edges[k];
+        arcs_[next[e.u]++] = {e.v, k};
+        arcs_[next[e.v]++] = {e.u, k};
+    }
+
+    orig_norms_.resize(edges.size());
+    min_norms_.resize(edges.size());
+    max_norms_.resize(edges.size());
+    for (int k = 0; k < edges.size(); k++) {
+        orig_norms_[k] = std::norm(vertices[edges[k].u] - vertices[edges[k].v]);
+        min_norms_[k] = prob->GetMinNorm(edges[k]);
+        max_norms_[k] = prob->GetMaxNorm(edges[k]);
+    }
+}
+
+int FigureGraph::FindEdge(int u, int v) const
+{
+    for (const Arc& arc : arcs(u)) {
+        if (arc.v == v) return arc.edge;
+    }
+    return -1;
+}
+
+#endif  // YUIZUMI_FIGURE_GRAPH_H_
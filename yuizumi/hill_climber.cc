@@ -1,7 +1,16 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <random>
-#include "v1.h"
+#include <thread>
+#include <utility>
+#include <vector>
+#include "v2.h"
 
 using namespace std;
 
@@ -17,68 +26,155 @@ constexpr int kWeightTranslate  = 25;
 constexpr int kNumMutateSteps = 1000000;
 
 
+//------------------------
+//  Config
+
+struct Config
+{
+    uint32_t seed = mt19937::default_seed;
+
+    // Simulated annealing instead of the greedy climbing.
+    bool anneal = false;
+
+    // Annealing: the weights of the mutations, the time budget, the
+    // temperature at the start and the end (decreasing geometrically), and
+    // the penalties for the excess of each edge over its valid length and
+    // for each edge not inside the hole.
+    int weight_flip = 30;
+    int weight_move = 60;
+    int weight_translate = 10;
+    double time_limit = 10.0;
+    double temp_start = 1000.0;
+    double temp_end = 1.0;
+    double weight_length = 10.0;
+    double weight_outside = 1000.0;
+
+    // Parallel tempering with this many threads, at the temperatures from
+    // temp_end to temp_start, exchanged every swap_interval steps.
+    int num_replicas = 0;
+    int swap_interval = 1000;
+
+    static Config FromJson(const Json& json);
+};
+
+Config Config::FromJson(const Json& json)
+{
+    Config config;
+
+    if (json.contains("seed")) {
+        config.seed = json.at("seed").get<uint32_t>();
+    }
+
+    if (json.contains("anneal")) {
+        config.anneal = json.at("anneal").get<bool>();
+    }
+
+    if (json.contains("weight_flip")) {
+        config.weight_flip = max(0, json.at("weight_flip").get<int>());
+    }
+    if (json.contains("weight_move")) {
+        config.weight_move = max(0, json.at("weight_move").get<int>());
+    }
+    if (json.contains("weight_translate")) {
+        config.weight_translate = max(0, json.at("weight_translate").get<int>());
+    }
+
+    if (json.contains("time_limit")) {
+        config.time_limit = json.at("time_limit").get<double>();
+    }
+    if (json.contains("temp_start")) {
+        config.temp_start = json.at("temp_start").get<double>();
+    }
+    if (json.contains("temp_end")) {
+        config.temp_end = json.at("temp_end").get<double>();
+    }
+    if (json.contains("weight_length")) {
+        config.weight_length = json.at("weight_length").get<double>();
+    }
+    if (json.contains("weight_outside")) {
+        config.weight_outside = json.at("weight_outside").get<double>();
+    }
+
+    if (json.contains("num_replicas")) {
+        config.num_replicas = max(0, json.at("num_replicas").get<int>());
+    }
+    if (json.contains("swap_interval")) {
+        // Taken modulo the steps.
+        config.swap_interval = max(1, json.at("swap_interval").get<int>());
+    }
+
+    return config;
+}
+
+
 //------------------------
 //  Mutator
 
 using Graph = vector<vector<int>>;
 
+// New positions of the vertices changed by a mutation.
+using Moves = vector<pair<int, Complex>>;
+
 class Mutator
 {
 public:
-    explicit Mutator(const Problem* prob);
+    Mutator(const Problem* prob, uint32_t seed,
+            int weight_flip, int weight_move, int weight_translate);
 
-    void Mutate(Pose& pose);
+    void Mutate(const Pose& pose, Moves& moves);
+
+    void Mutate(Pose& pose)
+    {
+        Moves moves;
+        Mutate(pose, moves);
+        for (const auto& [i, z] : moves) pose[i] = z;
+    }
 
 private:
-    void FlipVertex(Pose& pose);
-    void MoveVertex(Pose& pose);
-    void Translate(Pose& pose);
+    void FlipVertex(const Pose& pose, Moves& moves);
+    void MoveVertex(const Pose& pose, Moves& moves);
+    void Translate(const Pose& pose, Moves& moves);
 
     const Problem& prob_;
     Graph graph_;
     double x_size_, y_size_;
     mt19937 rng_;
+    discrete_distribution<> chooser_;
 };
 
-Mutator::Mutator(const Problem* const prob)
+Mutator::Mutator(const Problem* const prob, const uint32_t seed,
+                 const int weight_flip, const int weight_move,
+                 const int weight_translate)
     : prob_(*prob),
       graph_(prob_.vertices().size()),
-    rng_()  // random_device()?
+      rng_(seed),
+      chooser_({
+          static_cast<double>(weight_flip),
+          static_cast<double>(weight_move),
+          static_cast<double>(weight_translate),
+      })
 {
     for (const Edge& e : prob_.edges()) {
         graph_[e.u].push_back(e.v);
         graph_[e.v].push_back(e.u);
     }
 
-    double xmin = +kInfinity, xmax = -kInfinity;
-    double ymin = +kInfinity, ymax = -kInfinity;
-
-    for (const Complex z : prob_.hole().vertices()) {
-        xmin = min(xmin, z.real());
-        ymin = min(ymin, z.imag());
-        xmax = max(xmax, z.real());
-        ymax = max(ymax, z.imag());
-    }
-
-    x_size_ = xmax - xmin, y_size_ = ymax - ymin;
+    const Hole& hole = prob_.hole();
+    x_size_ = hole.xmax() - hole.xmin(), y_size_ = hole.ymax() - hole.ymin();
 }
 
-void Mutator::Mutate(Pose& pose)
+void Mutator::Mutate(const Pose& pose, Moves& moves)
 {
-    discrete_distribution<> chooser({
-        kWeightFlipVertex,
-        kWeightMoveVertex,
-        kWeightTranslate,
-    });
+    moves.clear();
 
-    switch (chooser(rng_)) {
-        case 0: FlipVertex(pose); break;
-        case 1: MoveVertex(pose); break;
-        case 2: Translate (pose); break;
+    switch (chooser_(rng_)) {
+        case 0: FlipVertex(pose, moves); break;
+        case 1: MoveVertex(pose, moves); break;
+        case 2: Translate (pose, moves); break;
     }
 }
 
-void Mutator::FlipVertex(Pose& pose)
+void Mutator::FlipVertex(const Pose& pose, Moves& moves)
 {
     uniform_int_distribution<> index_dist(0, pose.size() - 1);
     const int i = index_dist(rng_);
@@ -90,19 +186,17 @@ void Mutator::FlipVertex(Pose& pose)
         Complex z = polar(abs(pose[i] - pose[j]), theta_dist(rng_));
         z = Complex(round(z.real()), round(z.imag()));
 
-        const double d_orig = norm(prob_.vertices()[i] - prob_.vertices()[j]);
-        const double d_pose = norm(z - pose[j]);
-        if (std::abs(d_pose - d_orig) * kEpsDenom > prob_.epsilon() * d_orig)
+        if (!prob_.IsValidNorm(Edge{i, j}, norm(z - pose[j])))
             return;
 
-        pose[i] = z;
+        moves.emplace_back(i, z);
     }
 
     if (graph_[i].size() == 2) {
         const int j = graph_[i][0];
         const int k = graph_[i][1];
 
-        const vector<Complex> zs = GetIntersections(
+        const Intersections zs = GetIntersections(
             Circle{pose[j], abs(pose[j] - pose[i])},
             Circle{pose[k], abs(pose[k] - pose[i])});
         if (zs.size() != 2) return;
@@ -111,22 +205,25 @@ void Mutator::FlipVertex(Pose& pose)
         z = Complex(round(z.real()), round(z.imag()));
 
         for (const int j : graph_[i]) {
-            const double d_orig = norm(prob_.vertices()[i] - prob_.vertices()[j]);
-            const double d_pose = norm(z - pose[j]);
-            if (std::abs(d_pose - d_orig) * kEpsDenom > prob_.epsilon() * d_orig)
+            if (!prob_.IsValidNorm(Edge{i, j}, norm(z - pose[j])))
                 return;
         }
 
-        pose[i] = z;
+        moves.emplace_back(i, z);
     }
 }
 
-void Mutator::MoveVertex(Pose& pose)
+void Mutator::MoveVertex(const Pose& pose, Moves& moves)
 {
-    // TODO: Implement.
+    uniform_int_distribution<> index_dist(0, pose.size() - 1);
+    uniform_int_distribution<> delta_dist(-1, +1);
+
+    const int i = index_dist(rng_);
+    const Complex dz(delta_dist(rng_), delta_dist(rng_));
+    if (dz != 0.0) moves.emplace_back(i, pose[i] + dz);
 }
 
-void Mutator::Translate(Pose& pose)
+void Mutator::Translate(const Pose& pose, Moves& moves)
 {
     normal_distribution<> dx_dist(0.0, x_size_ / 2.0);
     const double dx = round(dx_dist(rng_));
@@ -134,7 +231,8 @@ void Mutator::Translate(Pose& pose)
     normal_distribution<> dy_dist(0.0, y_size_ / 2.0);
     const double dy = round(dy_dist(rng_));
 
-    for (Complex& z : pose) z += Complex(dx, dy);
+    for (int i = 0; i < pose.size(); i++)
+        moves.emplace_back(i, pose[i] + Complex(dx, dy));
 }
 
 
@@ -143,39 +241,215 @@ void Mutator::Translate(Pose& pose)
 
 long ComputeError(const Problem& prob, const Pose& pose)
 {
-    vector<int> contains(pose.size());
+    long invalid = 0;
 
-    for (int i = 0; i < pose.size(); i++) {
-        contains[i] = prob.hole().Contains(pose[i]);
+    for (const Edge& e : prob.edges()) {
+        if (!prob.hole().Contains(LineSeg{pose[e.u], pose[e.v]})) ++invalid;
     }
 
-    const vector<Complex>& hole = prob.hole().vertices();
-    long invalid = 0;
+    return invalid;
+}
 
-    for (const Edge& e : prob.edges()) {
-        if (!contains[e.u] || !contains[e.v]) {
-            ++invalid;
-            continue;
+
+//------------------------
+//  Energy
+
+// Weighted violations of the constraints plus dislikes, updated as the
+// vertices move.  The last update can be undone.
+class Energy
+{
+public:
+    Energy(const Problem* prob, const Config* cfg, Pose pose);
+
+    const Pose& pose() const { return pose_; }
+
+    double value() const { return penalty_ + dislikes_; }
+    bool valid() const { return num_invalid_ == 0; }
+
+    // Exact as long as the vertices are at integer points.
+    long dislikes() const { return static_cast<long>(dislikes_); }
+
+    void Apply(const Moves& moves);
+    void Undo();
+
+private:
+    // The penalty of an edge, and whether it is valid, which does not depend
+    // on the weights of the penalties (any of which may be 0).
+    struct EdgeState { double cost; bool valid; };
+
+    EdgeState GetEdgeState(int k) const;
+
+    void UpdateEdge(int k);
+    void UpdateNearest(int h);
+
+    const Problem& prob_;
+    const Config& cfg_;
+
+    Pose pose_;
+    vector<vector<int>> incident_;
+
+    vector<EdgeState> edge_state_;
+    double penalty_;
+    int num_invalid_;
+
+    vector<int> nearest_;
+    vector<double> nearest_norm_;
+    double dislikes_;
+
+    // Undo log of the last update.
+    Moves old_pose_;
+    vector<pair<int, EdgeState>> old_edge_state_;
+    vector<pair<int, pair<int, double>>> old_nearest_;
+    double old_penalty_, old_dislikes_;
+    int old_num_invalid_;
+
+    vector<int> stamp_;
+    int clock_ = 0;
+};
+
+Energy::Energy(const Problem* prob, const Config* cfg, Pose pose)
+    : prob_(*prob), cfg_(*cfg),
+      pose_(move(pose)),
+      incident_(pose_.size()),
+      edge_state_(prob_.edges().size()),
+      penalty_(0.0), num_invalid_(0),
+      nearest_(prob_.hole().size()),
+      nearest_norm_(prob_.hole().size()),
+      dislikes_(0.0),
+      stamp_(prob_.edges().size())
+{
+    for (int k = 0; k < prob_.edges().size(); k++) {
+        const Edge& e = prob_.edges()[k];
+        incident_[e.u].push_back(k);
+        incident_[e.v].push_back(k);
+        edge_state_[k] = GetEdgeState(k);
+        penalty_ += edge_state_[k].cost;
+        num_invalid_ += !edge_state_[k].valid;
+    }
+
+    for (int h = 0; h < prob_.hole().size(); h++) {
+        UpdateNearest(h);
+        dislikes_ += nearest_norm_[h];
+    }
+}
+
+Energy::EdgeState Energy::GetEdgeState(int k) const
+{
+    const Edge& e = prob_.edges()[k];
+    const vector<Complex>& orig = prob_.vertices();
+
+    const double d_orig = norm(orig[e.u] - orig[e.v]);
+    const double d_pose = norm(pose_[e.u] - pose_[e.v]);
+    const double excess = abs(d_pose - d_orig) - prob_.epsilon() * d_orig / kEpsDivisor;
+
+    EdgeState state = {0.0, true};
+    if (!prob_.IsValidNorm(e, d_pose)) {
+        state.cost += cfg_.weight_length * max(excess, 1.0);
+        state.valid = false;
+    }
+    if (!prob_.hole().Contains(LineSeg{pose_[e.u], pose_[e.v]})) {
+        state.cost += cfg_.weight_outside;
+        state.valid = false;
+    }
+    return state;
+}
+
+void Energy::UpdateEdge(int k)
+{
+    old_edge_state_.emplace_back(k, edge_state_[k]);
+
+    const EdgeState state = GetEdgeState(k);
+    penalty_ += state.cost - edge_state_[k].cost;
+    num_invalid_ += !state.valid - !edge_state_[k].valid;
+    edge_state_[k] = state;
+}
+
+void Energy::UpdateNearest(int h)
+{
+    const Complex zh = prob_.hole()[h];
+
+    nearest_[h] = 0;
+    nearest_norm_[h] = norm(zh - pose_[0]);
+    for (int i = 1; i < pose_.size(); i++) {
+        if (norm(zh - pose_[i]) < nearest_norm_[h]) {
+            nearest_[h] = i;
+            nearest_norm_[h] = norm(zh - pose_[i]);
         }
-        for (int i = 0; i < hole.size(); i++) {
-            const int j = (i + 1) % hole.size();
-            if (Intersects({pose[e.u], pose[e.v]}, {hole[i], hole[j]}) == kCrossing) {
-                ++invalid;
-                break;
+    }
+}
+
+void Energy::Apply(const Moves& moves)
+{
+    old_pose_.clear();
+    old_edge_state_.clear();
+    old_nearest_.clear();
+    old_penalty_ = penalty_;
+    old_dislikes_ = dislikes_;
+    old_num_invalid_ = num_invalid_;
+
+    ++clock_;
+
+    for (const auto& [i, z] : moves) {
+        old_pose_.emplace_back(i, pose_[i]);
+        pose_[i] = z;
+    }
+
+    for (const auto& [i, z] : moves) {
+        for (const int k : incident_[i]) {
+            if (stamp_[k] == clock_) continue;
+            stamp_[k] = clock_;
+            UpdateEdge(k);
+        }
+    }
+
+    const Hole& hole = prob_.hole();
+
+    for (int h = 0; h < hole.size(); h++) {
+        const pair<int, double> old = {nearest_[h], nearest_norm_[h]};
+        bool moved = false;
+
+        if (moves.size() == 1) {
+            const auto& [i, z] = moves[0];
+            const double d = norm(hole[h] - z);
+            if (d < nearest_norm_[h]) {
+                nearest_[h] = i, nearest_norm_[h] = d;
+            } else if (nearest_[h] == i) {
+                UpdateNearest(h);
             }
+            moved = (nearest_[h] != old.first || nearest_norm_[h] != old.second);
+        } else {
+            UpdateNearest(h);
+            moved = true;
         }
+
+        if (moved) {
+            old_nearest_.emplace_back(h, old);
+            dislikes_ += nearest_norm_[h] - old.second;
+        }
+    }
+}
+
+void Energy::Undo()
+{
+    for (const auto& [i, z] : old_pose_) pose_[i] = z;
+    for (const auto& [k, state] : old_edge_state_) edge_state_[k] = state;
+    for (const auto& [h, old] : old_nearest_) {
+        nearest_[h] = old.first, nearest_norm_[h] = old.second;
     }
 
-    return invalid;
+    penalty_ = old_penalty_;
+    dislikes_ = old_dislikes_;
+    num_invalid_ = old_num_invalid_;
 }
 
 
 //------------------------
 //  Solve
 
-Pose Solve(const Problem& prob)
+Pose Solve(const Problem& prob, const Config& cfg)
 {
-    Mutator mutator(&prob);
+    Mutator mutator(&prob, cfg.seed,
+                    kWeightFlipVertex, kWeightMoveVertex, kWeightTranslate);
 
     Pose pose = prob.vertices();
 
@@ -193,7 +467,7 @@ Pose Solve(const Problem& prob)
 
         const long error = ComputeError(prob, pose);
         if (error == 0) {
-            const long score = Evaluate(prob, pose);
+            const long score = Dislikes(prob, pose);
             if (score < best_score) {
                 best_score = score;
                 best_pose = pose;
@@ -208,22 +482,241 @@ Pose Solve(const Problem& prob)
     return best_pose;
 }
 
+//------------------------
+//  Chain
+
+// Markov chain of poses under the Metropolis rule.
+class Chain
+{
+public:
+    Chain(const Problem* prob, const Config* cfg, Pose pose, uint32_t seed)
+        : mutator_(prob, seed, cfg->weight_flip, cfg->weight_move,
+                   cfg->weight_translate),
+          energy_(prob, cfg, move(pose)),
+          // Not the stream of the mutator, or the acceptance would follow
+          // the proposal.
+          rng_(seed ^ 0x9e3779b9u),
+          best_pose_(energy_.pose()) {}
+
+    void Step(double temp);
+
+    const Energy& energy() const { return energy_; }
+
+    long best_score() const { return best_score_; }
+    const Pose& best_pose() const { return best_pose_; }
+
+private:
+    Mutator mutator_;
+    Energy energy_;
+    mt19937 rng_;
+    uniform_real_distribution<double> prob_dist_{0.0, 1.0};
+    Moves moves_;
+
+    long best_score_ = numeric_limits<long>::max();
+    Pose best_pose_;
+};
+
+void Chain::Step(double temp)
+{
+    mutator_.Mutate(energy_.pose(), moves_);
+    if (moves_.empty()) return;
+
+    const double before = energy_.value();
+    energy_.Apply(moves_);
+    const double delta = energy_.value() - before;
+
+    if (delta > 0.0 && prob_dist_(rng_) >= exp(-delta / temp)) {
+        energy_.Undo();
+        return;
+    }
+
+    if (energy_.valid() && energy_.dislikes() < best_score_) {
+        best_score_ = energy_.dislikes();
+        best_pose_ = energy_.pose();
+    }
+}
+
+
+//------------------------
+//  Anneal
+
+using Clock = chrono::steady_clock;
+
+double Elapsed(Clock::time_point start)
+{
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+Pose Anneal(const Problem& prob, const Config& cfg, Pose pose)
+{
+    Chain chain(&prob, &cfg, move(pose), cfg.seed);
+
+    const Clock::time_point start = Clock::now();
+    double temp = cfg.temp_start;
+
+    for (long step = 0; ; step++) {
+        if (step % 256 == 0) {
+            const double t = Elapsed(start) / cfg.time_limit;
+            if (t >= 1.0) break;
+            temp = cfg.temp_start * pow(cfg.temp_end / cfg.temp_start, t);
+        }
+        if (step % 100000 == 0) {
+            cerr << "Step " << step << ": temp = " << temp << ", "
+                 << "energy = " << chain.energy().value() << ", "
+                 << "score = " << chain.best_score() << endl;
+        }
+
+        chain.Step(temp);
+    }
+
+    return chain.best_pose();
+}
+
+
+//------------------------
+//  Temper
+
+// Parallel tempering: runs the chains on their own threads, each at one of
+// the fixed temperatures (levels), and exchanges the temperatures of the
+// chains at adjacent levels from time to time.
+class Tempering
+{
+public:
+    Tempering(const Problem* prob, const Config* cfg, const Pose& pose);
+
+    Pose Run();
+
+private:
+    void Run(int r);
+    void TrySwap(int r);
+
+    const Config& cfg_;
+    const int size_;
+
+    vector<double> temps_;
+    vector<unique_ptr<Chain>> chains_;
+
+    // Chain at each level, level of each chain, and the latest energy of
+    // each chain.  A swap between the levels l and l + 1 takes the flags
+    // of both, or gives up without waiting.
+    unique_ptr<atomic<int>[]> slots_;
+    unique_ptr<atomic<int>[]> levels_;
+    unique_ptr<atomic<double>[]> energies_;
+    unique_ptr<atomic_flag[]> busy_;
+
+    atomic<long> num_tries_{0};
+    atomic<long> num_swaps_{0};
+};
+
+Tempering::Tempering(const Problem* prob, const Config* cfg, const Pose& pose)
+    : cfg_(*cfg),
+      size_(cfg->num_replicas),
+      slots_(new atomic<int>[size_]),
+      levels_(new atomic<int>[size_]),
+      energies_(new atomic<double>[size_]),
+      busy_(new atomic_flag[size_])
+{
+    for (int r = 0; r < size_; r++) {
+        const double t = (size_ == 1) ? 0.0 : static_cast<double>(r) / (size_ - 1);
+        temps_.push_back(cfg_.temp_end * pow(cfg_.temp_start / cfg_.temp_end, t));
+        chains_.push_back(make_unique<Chain>(prob, cfg, pose, cfg_.seed + r));
+
+        slots_[r] = r;
+        levels_[r] = r;
+        energies_[r] = chains_[r]->energy().value();
+        busy_[r].clear();
+    }
+}
+
+Pose Tempering::Run()
+{
+    vector<thread> threads;
+    for (int r = 0; r < size_; r++) threads.emplace_back([this, r] { Run(r); });
+    for (thread& t : threads) t.join();
+
+    int best = 0;
+    for (int r = 0; r < size_; r++) {
+        cerr << "Replica " << r << ": score = " << chains_[r]->best_score() << endl;
+        if (chains_[r]->best_score() < chains_[best]->best_score()) best = r;
+    }
+    cerr << "Swaps: " << num_swaps_ << " / " << num_tries_ << endl;
+
+    return chains_[best]->best_pose();
+}
+
+void Tempering::Run(int r)
+{
+    Chain& chain = *chains_[r];
+    const Clock::time_point start = Clock::now();
+
+    for (long step = 1; ; step++) {
+        if (step % 256 == 0 && Elapsed(start) >= cfg_.time_limit) break;
+
+        chain.Step(temps_[levels_[r].load(memory_order_relaxed)]);
+        energies_[r].store(chain.energy().value(), memory_order_relaxed);
+
+        if (step % cfg_.swap_interval == 0) TrySwap(r);
+    }
+}
+
+void Tempering::TrySwap(int r)
+{
+    const int l = levels_[r].load();
+    if (l + 1 >= size_) return;
+
+    if (busy_[l].test_and_set()) return;
+    if (busy_[l + 1].test_and_set()) {
+        busy_[l].clear();
+        return;
+    }
+
+    // The chain may have moved before the flags were taken.
+    if (slots_[l].load() == r) {
+        const int s = slots_[l + 1].load();
+        const double x = (1.0 / temps_[l] - 1.0 / temps_[l + 1])
+            * (energies_[r].load() - energies_[s].load());
+
+        // One generator per thread, as each thread runs one chain; not the
+        // streams of its chain (seeded with cfg_.seed + r, see Chain).
+        thread_local mt19937 rng((cfg_.seed + r) ^ 0x85ebca6bu);
+        ++num_tries_;
+        if (x >= 0.0 || uniform_real_distribution<double>(0.0, 1.0)(rng) < exp(x)) {
+            slots_[l] = s, slots_[l + 1] = r;
+            levels_[r] = l + 1, levels_[s] = l;
+            ++num_swaps_;
+        }
+    }
+
+    busy_[l + 1].clear();
+    busy_[l].clear();
+}
+
 }  // namespace
 
 //------------------------
 //  Entrypoint
 
-int main()
+int main(int argc, char* argv[])
 {
+    Config cfg;
+
+    if (argc >= 2) cfg = Config::FromJson(Json::parse(argv[1]));
     Json json;
     cin >> json;
 
     const Problem prob = Problem::FromJson(json);
-    const Pose pose = Solve(prob);
+    Pose pose;
+    if (cfg.num_replicas > 0) {
+        pose = Tempering(&prob, &cfg, prob.vertices()).Run();
+    } else if (cfg.anneal) {
+        pose = Anneal(prob, cfg, prob.vertices());
+    } else {
+        pose = Solve(prob, cfg);
+    }
 
     if (Validate(prob, pose)) {
         cout << PoseToJson(pose) << endl;
-        cerr << "dislikes = " << Evaluate(prob, pose) << endl;
+        cerr << "dislikes = " << Dislikes(prob, pose) << endl;
     } else {
         cerr << "dislikes = (error)" << endl;
     }
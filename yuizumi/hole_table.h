@@ -0,0 +1,130 @@
+#ifndef YUIZUMI_HOLE_TABLE_H_
+#define YUIZUMI_HOLE_TABLE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "v2.h"
+#include "alloc_count.h"
+
+
+//------------------------
+//  HoleSet
+
+// Set of the hole vertices, by their indices.
+class HoleSet
+{
+public:
+    explicit HoleSet(int size = 0) : size_(size), bits_((size + 63) / 64) {}
+
+    static HoleSet Full(int size)
+    {
+        HoleSet set(size);
+        set.Fill();
+        return set;
+    }
+
+    int size() const { return size_; }
+
+    // Adds or removes all the elements, keeping the storage.
+    void Fill()
+    {
+        std::fill(bits_.begin(), bits_.end(), ~uint64_t{0});
+        if (size_ % 64 != 0) bits_.back() = (uint64_t{1} << (size_ % 64)) - 1;
+    }
+    void Clear() { std::fill(bits_.begin(), bits_.end(), 0); }
+
+    bool Get(int i) const { return (bits_[i / 64] >> (i % 64)) & 1; }
+    void Set(int i) { bits_[i / 64] |= uint64_t{1} << (i % 64); }
+    void Reset(int i) { bits_[i / 64] &= ~(uint64_t{1} << (i % 64)); }
+
+    HoleSet& operator&=(const HoleSet& other)
+    {
+        for (int k = 0; k < bits_.size(); k++) bits_[k] &= other.bits_[k];
+        return *this;
+    }
+
+    // Removes the elements of the other set.
+    void Subtract(const HoleSet& other)
+    {
+        for (int k = 0; k < bits_.size(); k++) bits_[k] &= ~other.bits_[k];
+    }
+
+    template <typename Func> void ForEach(Func func) const
+    {
+        for (int k = 0; k < bits_.size(); k++) {
+            for (uint64_t w = bits_[k]; w != 0; w &= w - 1)
+                func(k * 64 + __builtin_ctzll(w));
+        }
+    }
+
+private:
+    int size_;
+    std::vector<uint64_t> bits_;
+};
+
+
+//------------------------
+//  HoleTable
+
+// Which pairs of hole vertices each edge of the figure can connect, with a
+// valid length and inside the hole.  The rows are computed on demand.
+class HoleTable
+{
+public:
+    explicit HoleTable(const Problem* prob);
+
+    // Index of the hole vertex at z, or -1.
+    int Find(Complex z) const
+    {
+        const auto iter = index_.find(z);
+        return (iter != index_.end()) ? iter->second : -1;
+    }
+
+    // Hole vertices where either end of the k-th edge can be when the other
+    // is on the j-th.
+    const HoleSet& Get(int k, int j);
+
+private:
+    const Problem& prob_;
+
+    std::unordered_map<Complex, int> index_;
+    std::vector<std::vector<HoleSet>> rows_;
+};
+
+HoleTable::HoleTable(const Problem* prob)
+    : prob_(*prob),
+      rows_(prob_.edges().size())
+{
+    const Hole& hole = prob_.hole();
+    for (int i = 0; i < hole.size(); i++) index_.emplace(hole[i], i);
+}
+
+const HoleSet& HoleTable::Get(int k, int j)
+{
+    const Hole& hole = prob_.hole();
+
+    // The rows are filled once each, as a cache.
+    UNCOUNTED_ALLOCS();
+
+    if (rows_[k].empty()) rows_[k].resize(hole.size());
+
+    HoleSet& row = rows_[k][j];
+
+    // An empty row is yet to be computed.
+    if (row.size() == 0) {
+        const Edge e = prob_.edges()[k];
+        row = HoleSet(hole.size());
+        for (int i = 0; i < hole.size(); i++) {
+            if (prob_.IsValidNorm(e, std::norm(hole[i] - hole[j]))
+                && hole.Contains(LineSeg{hole[j], hole[i]}))
+                row.Set(i);
+        }
+    }
+
+    return row;
+}
+
+#endif  // YUIZUMI_HOLE_TABLE_H_
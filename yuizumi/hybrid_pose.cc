@@ -1,11 +1,16 @@
 #include <cstdint>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <optional>
+#include <queue>
 #include <random>
 #include <utility>
 #include <vector>
 #include "v2.h"
+#include "poser.h"
+#include "bench.h"
+#include "perf.h"
 
 namespace {
 
@@ -13,331 +18,271 @@ using namespace std;
 
 
 //------------------------
-//  Random
+//  Population
 
-class Random
+// Valid poses with their dislikes, held in a single array of coordinates.
+class Population
 {
 public:
-    explicit Random(uint_fast32_t seed) : rng_(seed) {}
+    Population(int num_vertices, int capacity)
+        : num_vertices_(num_vertices), capacity_(capacity)
+    {
+        arena_.reserve(2L * num_vertices * capacity);
+    }
 
-    mt19937& rng() { return rng_; }
+    int size() const { return dislikes_.size(); }
 
-    bool Bernoulli(double prob)
+    long dislikes(int i) const { return dislikes_[i]; }
+
+    Complex Get(int i, int v) const
     {
-        return bernoulli_distribution(prob)(rng_);
+        const int32_t* xy = &arena_[2L * (i * num_vertices_ + v)];
+        return Complex(xy[0], xy[1]);
     }
-    
-    double Get(double lo, double hi)
+
+    Pose Get(int i) const
     {
-        return uniform_real_distribution<double>(lo, hi)(rng_);
+        Pose pose(num_vertices_);
+        for (int v = 0; v < num_vertices_; v++) pose[v] = Get(i, v);
+        return pose;
     }
 
-    int Get(int lo, int hi)
+    bool Contains(const Pose& pose) const
     {
-        return uniform_int_distribution<int>(lo, hi)(rng_);
+        for (int i = 0; i < size(); i++) {
+            int v = 0;
+            while (v < num_vertices_ && Get(i, v) == pose[v]) v++;
+            if (v == num_vertices_) return true;
+        }
+        return false;
     }
 
-private:
-    mt19937 rng_;
-};
-
+    // Adds the pose, or replaces the worst one when full.  Returns false if
+    // the pose is no better than the worst.
+    bool Add(const Pose& pose, long dislikes);
 
-//------------------------
-//  Hint
-
-struct Hint
-{
-    int index;
-    Complex z;
-
-    static Hint FromJson(const Json& json);
-};
-
-Hint Hint::FromJson(const Json& json)
-{
-    return {
-        .index = json[0].get<int>(),
-        .z = Complex(json[1][0].get<int>(), json[1][1].get<int>()),
-    };
-}
-
-
-//------------------------
-//  Config
-
-struct Config
-{
-    vector<Hint> hints;
-
-    uint32_t seed = mt19937::default_seed;
-
-    double prob_hole = 0.5;
+private:
+    void Set(int i, const Pose& pose)
+    {
+        int32_t* xy = &arena_[2L * i * num_vertices_];
+        for (const Complex z : pose) {
+            *xy++ = static_cast<int32_t>(z.real());
+            *xy++ = static_cast<int32_t>(z.imag());
+        }
+    }
 
-    int num_poses = 5000;
-    int max_total_steps = 50000;
-    int max_local_steps = 25;
+    const int num_vertices_;
+    const int capacity_;
 
-    static Config FromJson(const Json& json);
+    vector<int32_t> arena_;
+    vector<long> dislikes_;
 };
 
-Config Config::FromJson(const Json& json)
+bool Population::Add(const Pose& pose, long dislikes)
 {
-    Config config;
-
-    if (json.contains("hints")) {
-        config.hints.reserve(json.at("hints").size());
-        for (const Json& hint : json.at("hints"))
-            config.hints.push_back(Hint::FromJson(hint));
-    }
-
-    if (json.contains("seed")) {
-        config.seed = json.at("seed").get<uint32_t>();
-    }
-
-    if (json.contains("prob_hole")) {
-        config.prob_hole = json.at("prob_hole").get<double>();
-    }
-    if (json.contains("num_poses")) {
-        config.num_poses = json.at("num_poses").get<int>();
-    }
-    if (json.contains("max_total_steps")) {
-        config.max_total_steps = json.at("max_total_steps").get<int>();
-    }
-    if (json.contains("max_local_steps")) {
-        config.max_local_steps = json.at("max_local_steps").get<int>();
+    if (size() < capacity_) {
+        arena_.resize(arena_.size() + 2L * num_vertices_);
+        dislikes_.push_back(dislikes);
+        Set(size() - 1, pose);
+        return true;
     }
 
-    return config;
+    const int worst = max_element(dislikes_.begin(), dislikes_.end()) - dislikes_.begin();
+    if (dislikes >= dislikes_[worst]) return false;
+    dislikes_[worst] = dislikes;
+    Set(worst, pose);
+    return true;
 }
 
 
 //------------------------
-//  Poser
+//  Crossover
 
-class Poser
+// Takes a connected region from one parent, then the vertices of the other
+// consistent with those taken so far, as the hints for a child.
+class Crossover
 {
 public:
-    Poser(const Problem* prob, const Config* cfg)
-        : prob_(*prob), cfg_(*cfg),
-          random_(cfg_.seed) {}
+    Crossover(const Problem* prob, Random* random);
 
-    optional<Pose> MakePose();
+    vector<Hint> MakeHints(const Population& pop, int a, int b);
 
 private:
-    bool MakePose(Pose& pose, int index);
-
-    void Prepare(Pose& pose);
-
-    bool IsFeasible(const Pose& pose, Complex z, int v) const;
-
-    optional<Complex> LocateHole(const Pose& pose, int v);
-
-    optional<Complex> LocateDeg0(const Pose& pose, int v);
-    optional<Complex> LocateDeg1(const Pose& pose, int v, int u);
-    optional<Complex> LocateDeg2(const Pose& pose, int v, int u, int t);
-
-    optional<Complex> Locate(const Pose& pose, int v);
-
     const Problem& prob_;
-    const Config& cfg_;
-
-    int steps_left_;
-    vector<vector<int>> adj_;
-    vector<int> order_;
-    Random random_;
+    Random& random_;
+    vector<vector<int>> graph_;
 };
 
-optional<Pose> Poser::MakePose()
+Crossover::Crossover(const Problem* prob, Random* random)
+    : prob_(*prob), random_(*random),
+      graph_(prob_.vertices().size())
 {
-    Pose pose(prob_.vertices().size());
-    steps_left_ = cfg_.max_total_steps;
-    Prepare(pose);
-    if (MakePose(pose, cfg_.hints.size())) return pose;
-    return nullopt;
+    for (const Edge& edge : prob_.edges()) {
+        graph_[edge.u].push_back(edge.v);
+        graph_[edge.v].push_back(edge.u);
+    }
 }
 
-void Poser::Prepare(Pose& pose)
+vector<Hint> Crossover::MakeHints(const Population& pop, int a, int b)
 {
     const int n = prob_.vertices().size();
-    vector<vector<int>> adj(n);
-
-    for (const Edge& edge : prob_.edges()) {
-        adj[edge.u].push_back(edge.v);
-        adj[edge.v].push_back(edge.u);
-    }
-
-    order_.clear();
-    adj_.clear();
+    const int size = random_.Get(max(1, n / 4), max(1, n * 3 / 4));
 
-    order_.reserve(n);
-    adj_.resize(n);
-
-    vector<int> done(n);
-
-    for (const Hint& hint : cfg_.hints) {
-        const int u = hint.index;
-        pose[u] = hint.z;
-
-        order_.push_back(u);
-
-        shuffle(adj[u].begin(), adj[u].end(), random_.rng());
-        for (const int v : adj[u]) { if (!done[v]) adj_[v].push_back(u); }
-        done[u] = true;
+    vector<Hint> hints;
+    vector<int> taken(n);
+    vector<int> queue = {random_.Get(0, n - 1)};
+    taken[queue[0]] = true;
+
+    for (int i = 0; i < queue.size() && hints.size() < size; i++) {
+        const int u = queue[i];
+        hints.push_back({u, pop.Get(a, u)});
+        for (const int v : graph_[u]) {
+            if (!taken[v]) { taken[v] = true; queue.push_back(v); }
+        }
     }
 
-    vector<int> next;
-    next.reserve(n);
-
-    while (order_.size() < n) {
-        int max_deg = -1;
-
-        for (int v = 0; v < n; v++) {
-            const int deg = adj_[v].size();
-            if (!done[v] && deg >= max_deg) {
-                if (deg != max_deg) next.clear();
-                next.push_back(v);
-                max_deg = deg;
-            }
+    for (const int u : queue) taken[u] = false;
+    for (const Hint& hint : hints) taken[hint.index] = true;
+
+    for (int u = 0; u < n; u++) {
+        if (taken[u]) continue;
+        const Complex z = pop.Get(b, u);
+        const bool consistent = all_of(graph_[u].begin(), graph_[u].end(), [&](int v) {
+            if (!taken[v]) return true;
+            const Complex w = pop.Get(taken[v] == 1 ? a : b, v);
+            return prob_.IsValidNorm(Edge{u, v}, norm(z - w))
+                && prob_.hole().Contains(LineSeg{z, w});
+        });
+        if (consistent) {
+            hints.push_back({u, z});
+            taken[u] = 2;
         }
-
-        const int u = next[random_.Get(0, next.size() - 1)];
-
-        order_.push_back(u);
-
-        shuffle(adj[u].begin(), adj[u].end(), random_.rng());
-        for (const int v : adj[u]) { if (!done[v]) adj_[v].push_back(u); }
-        done[u] = true;
     }
-}
 
-bool Poser::IsFeasible(const Pose& pose, Complex z, int v) const
-{
-    return all_of(adj_[v].begin(), adj_[v].end(), [&](const int u) {
-        return prob_.IsValidNorm(Edge{u, v}, norm(pose[u] - z))
-            && prob_.hole().Contains(LineSeg{pose[u], z});
-    });
+    return hints;
 }
 
-optional<Complex> Poser::LocateHole(const Pose& pose, int v)
-{
-    optional<Complex> picked;
-    int count = 0;
 
-    for (const Complex z : prob_.hole().vertices()) {
-        bool done = false;
-
-        for (const int u : order_) {
-            if (u == v) break;
-            if (pose[u] == z) { done = true; break; }
-        }
-        if (done) continue;
-
-        if (IsFeasible(pose, z, v) && random_.Get(0, count++) == 0)
-            picked = z;
-    }
-
-    return picked;
-}
+//------------------------
+//  Solve
 
-optional<Complex> Poser::LocateDeg0(const Pose& pose, int v)
+Pose Polish(const Problem& prob, Poser& poser, const Pose& pose)
 {
-    const Hole& hole = prob_.hole();
-    while (true) {
-        const Complex z(random_.Get(hole.xmin(), hole.xmax()),
-                        random_.Get(hole.ymin(), hole.ymax()));
-        if (hole.Contains(z)) return z;
-    }
+    const Pose polished = poser.Polish(pose);
+    cerr << "Polish: " << Dislikes(prob, pose) << " -> "
+         << Dislikes(prob, polished) << endl;
+    return polished;
 }
 
-optional<Complex> Poser::LocateDeg1(const Pose& pose, int v, int u)
+// Prints the counters of the search on stderr, and writes the trace into
+// cfg.trace_file, if compiled in.
+void ReportStats(const Poser& poser, const Config& cfg)
 {
-    const double norm = random_.Get(prob_.GetMinNorm(Edge{u, v}),
-                                    prob_.GetMaxNorm(Edge{u, v}));
-    const double arg = random_.Get(-M_PI, +M_PI);
-    return pose[u] + polar(sqrt(norm), arg);
+#ifdef POSER_STATS
+    cerr << poser.stats().ToJson() << endl;
+#endif
+#ifdef POSER_TRACE
+    if (!poser.trace().Dump(cfg.trace_file))
+        cerr << cfg.trace_file << ": failed to write" << endl;
+#endif
 }
 
-optional<Complex> Poser::LocateDeg2(const Pose& pose, int v, int u, int t)
+// Keeps a population of valid poses and replaces the worst with children
+// of two parents chosen by tournaments.
+optional<Pose> Evolve(const Problem& prob, const Config& cfg)
 {
-    const double rt_sq = random_.Get(prob_.GetMinNorm(Edge{t, v}),
-                                     prob_.GetMaxNorm(Edge{t, v}));
-    const double ru_sq = random_.Get(prob_.GetMinNorm(Edge{u, v}),
-                                     prob_.GetMaxNorm(Edge{u, v}));
+    const int n = prob.vertices().size();
 
-    const vector<Complex> zs = GetIntersections(Circle{pose[t], sqrt(rt_sq)},
-                                                Circle{pose[u], sqrt(ru_sq)});
-    if (zs.empty()) return nullopt;
-
-    return (random_.Bernoulli(0.5)) ? zs.front() : zs.back();
-}
-
-optional<Complex> Poser::Locate(const Pose& pose, int v)
-{
-    if (random_.Bernoulli(cfg_.prob_hole)) {
-        const optional<Complex> z = LocateHole(pose, v);
-        if (z.has_value()) return z;
-    }
+    Poser poser(&prob, &cfg);
+    Population pop(n, cfg.population);
 
-    int adj = -1;
+    // Made into the same storage each time; the population copies it.
+    Pose pose;
 
-    for (const int u : adj_[v]) {
-        if (adj == -1) {
-            adj = u;
-        } else {
-            if (pose[u] != pose[adj]) return LocateDeg2(pose, v, u, adj);
-        }
+    for (int i = 1; i <= cfg.num_poses && pop.size() < cfg.population; i++) {
+        PERF_START();
+        const bool made = poser.MakePose(cfg.hints, pose);
+        PERF_STOP(PerfPhase::kSearch);
+        if (made) pop.Add(pose, Dislikes(prob, pose));
+        if (i % 100 == 0) cerr << "(" << i << ")";
     }
-    return (adj == -1) ? LocateDeg0(pose, v) :LocateDeg1(pose, v, adj);
-}
+    if (pop.size() == 0) return nullopt;
 
-bool Poser::MakePose(Pose& pose, int index)
-{
-    if (index == order_.size()) {
-        return true;
-    }
+    // Not the stream of the poser, which draws from cfg.seed as well.
+    Random random(cfg.seed ^ 0x9e3779b9u);
+    Crossover crossover(&prob, &random);
 
-    const int v = order_[index];
-    vector<Complex> done;
+    const auto choose = [&]() {
+        const int i = random.Get(0, pop.size() - 1);
+        const int j = random.Get(0, pop.size() - 1);
+        return (pop.dislikes(i) <= pop.dislikes(j)) ? i : j;
+    };
 
-    for (int step = 0; step < cfg_.max_local_steps; step++) {
-        if (--steps_left_ < 0)
-            return false;
+    const auto best = [&]() {
+        int k = 0;
+        for (int i = 1; i < pop.size(); i++) {
+            if (pop.dislikes(i) < pop.dislikes(k)) k = i;
+        }
+        return k;
+    };
 
-        const optional<Complex> z = Locate(pose, v);
-        if (!z.has_value()) return false;
+    cerr << "[0:" << pop.dislikes(best()) << "]";
 
-        pose[v] = Complex(round(z->real()), round(z->imag()));
+    vector<Hint> hints;
 
-        if (find(done.begin(), done.end(), pose[v]) != done.end())
-            continue;
-        done.push_back(pose[v]);
+    for (int i = 1; i <= cfg.num_children && pop.dislikes(best()) > 0; i++) {
+        hints.assign(cfg.hints.begin(), cfg.hints.end());
+        for (const Hint& hint : crossover.MakeHints(pop, choose(), choose())) {
+            const bool hinted = any_of(hints.begin(), hints.end(), [&](const Hint& h) {
+                return h.index == hint.index;
+            });
+            if (!hinted) hints.push_back(hint);
+        }
 
-        if (IsFeasible(pose, pose[v], v) && MakePose(pose, index + 1))
-            return true;
+        PERF_START();
+        const bool made = poser.MakePose(hints, pose);
+        PERF_STOP(PerfPhase::kSearch);
+        if (made && !pop.Contains(pose)) {
+            const long dislikes = Dislikes(prob, pose);
+            const long before = pop.dislikes(best());
+            if (pop.Add(pose, dislikes) && dislikes < before)
+                cerr << "[" << i << ":" << dislikes << "]";
+        }
+        if (i % 10 == 0) {
+            (i % 100 == 0) ? (cerr << "(" << i << ")") : (cerr << ".");
+        }
     }
+    cerr << endl;
 
-    return false;
-}
-
+    ReportStats(poser, cfg);
 
-//------------------------
-//  Solve
+    pose = pop.Get(best());
+    return cfg.polish ? Polish(prob, poser, pose) : pose;
+}
 
 optional<Pose> Solve(const Problem& prob, const Config& cfg)
 {
-    long best_dislikes = numeric_limits<long>::max();
-    optional<Pose> best_pose;
+    if (cfg.population > 0) return Evolve(prob, cfg);
 
+    long best_dislikes = numeric_limits<long>::max();
     Poser poser(&prob, &cfg);
 
+    // The poses are made into the same two buffers, swapped on each
+    // improvement rather than copied.
+    Pose pose(prob.vertices().size()), best(prob.vertices().size());
+
     for (int i = 1; i <= cfg.num_poses; i++) {
-        const optional<Pose> pose = poser.MakePose();
-        if (pose.has_value()) {
-            const long dislikes = Dislikes(prob, *pose);
+        PERF_START();
+        const bool made = poser.MakePose(cfg.hints, pose);
+        PERF_STOP(PerfPhase::kSearch);
+        if (made) {
+            PERF_START();
+            const long dislikes = Dislikes(prob, pose);
+            PERF_STOP(PerfPhase::kDislikes);
             if (dislikes < best_dislikes) {
                 cerr << "[" << i << ":" << dislikes << "]";
                 best_dislikes = dislikes;
-                best_pose = pose;
+                best.swap(pose);
             }
             if (dislikes == 0) break;
         }
@@ -346,7 +291,26 @@ optional<Pose> Solve(const Problem& prob, const Config& cfg)
         }
     }
     cerr << endl;
-    return best_pose;
+
+    ReportStats(poser, cfg);
+
+    if (best_dislikes == numeric_limits<long>::max()) return nullopt;
+    return cfg.polish ? Polish(prob, poser, best) : best;
+}
+
+// See bench.h.
+MakePoseFunc LoadForBenchmark(istream& in, uint32_t seed)
+{
+    Json json;
+    in >> json;
+    const shared_ptr<const Problem> prob(new Problem(Problem::FromJson(json)));
+    const auto cfg = make_shared<Config>();
+    cfg->seed = seed;
+    const auto poser = make_shared<Poser>(prob.get(), cfg.get());
+    return [prob, cfg, poser, pose = Pose()]() mutable -> optional<long> {
+        if (!poser->MakePose(cfg->hints, pose)) return nullopt;
+        return Dislikes(*prob, pose);
+    };
 }
 
 }  // namespace
@@ -356,13 +320,23 @@ optional<Pose> Solve(const Problem& prob, const Config& cfg)
 
 int main(int argc, char* argv[])
 {
+    if (argc >= 2 && string(argv[1]) == "--bench") {
+        return BenchmarkMain(argc - 1, argv + 1, "hybrid_pose",
+                             LoadForBenchmark);
+    }
+
     Config cfg;
 
     if (argc >= 2) cfg = Config::FromJson(Json::parse(argv[1]));
     Json json;
     cin >> json;
-    const optional<Pose> pose = Solve(Problem::FromJson(json), cfg);
+    PERF_START();
+    const Problem prob = Problem::FromJson(json);
+    PERF_STOP(PerfPhase::kHole);
+
+    const optional<Pose> pose = Solve(prob, cfg);
     if (pose.has_value()) cout << PoseToJson(*pose) << endl;
+    PERF_REPORT();
 
     return 0;
 }
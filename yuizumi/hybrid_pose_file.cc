@@ -279,8 +279,8 @@ optional<Complex> Poser::LocateDeg2(const Pose& pose, int v, int u, int t)
     const double ru_sq = random_.Get(prob_.GetMinNorm(Edge{u, v}),
                                      prob_.GetMaxNorm(Edge{u, v}));
 
-    const vector<Complex> zs = GetIntersections(Circle{pose[t], sqrt(rt_sq)},
-                                                Circle{pose[u], sqrt(ru_sq)});
+    const Intersections zs = GetIntersections(Circle{pose[t], sqrt(rt_sq)},
+                                               Circle{pose[u], sqrt(ru_sq)});
     if (zs.empty()) return nullopt;
 
     return (random_.Bernoulli(0.5)) ? zs.front() : zs.back();
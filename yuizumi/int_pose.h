@@ -0,0 +1,131 @@
+#ifndef YUIZUMI_INT_POSE_H_
+#define YUIZUMI_INT_POSE_H_
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "v2.h"
+
+
+//------------------------
+//  IntPose
+
+// A pose with the x and y coordinates in separate integer arrays, so that the
+// ends of all the edges can be loaded together (see PoseValidator).
+struct IntPose
+{
+    std::vector<int32_t> x;
+    std::vector<int32_t> y;
+
+    IntPose() = default;
+    explicit IntPose(int n) : x(n), y(n) {}
+
+    int size() const { return x.size(); }
+
+    Complex operator[](int v) const { return Complex(x[v], y[v]); }
+
+    void Set(int v, Complex z)
+    {
+        x[v] = static_cast<int32_t>(z.real());
+        y[v] = static_cast<int32_t>(z.imag());
+    }
+};
+
+IntPose ToIntPose(const Pose& pose)
+{
+    IntPose int_pose(pose.size());
+    for (int v = 0; v < int_pose.size(); v++) int_pose.Set(v, pose[v]);
+    return int_pose;
+}
+
+Pose ToPose(const IntPose& int_pose)
+{
+    Pose pose(int_pose.size());
+    for (int v = 0; v < int_pose.size(); v++) pose[v] = int_pose[v];
+    return pose;
+}
+
+Json IntPoseToJson(const IntPose& pose)
+{
+    Json vertices = Json::array();
+    for (int v = 0; v < pose.size(); v++) vertices.push_back({pose.x[v], pose.y[v]});
+    return {{"vertices", vertices}};
+}
+
+IntPose IntPoseFromJson(const Json& json)
+{
+    const Json& vertices = json.at("vertices");
+    IntPose pose(vertices.size());
+    for (int v = 0; v < pose.size(); v++) {
+        pose.x[v] = vertices[v][0].get<int32_t>();
+        pose.y[v] = vertices[v][1].get<int32_t>();
+    }
+    return pose;
+}
+
+
+//------------------------
+//  PoseValidator
+
+// Same as Validate(), for many poses of one problem.  The lengths of all the
+// edges are checked first, in one pass without branches which the compiler
+// can vectorize (e.g. with -O3 -mavx2), and the containment only once all of
+// them are valid.
+class PoseValidator
+{
+public:
+    explicit PoseValidator(const Problem* prob);
+
+    // The pose must have as many vertices as the figure.
+    bool Validate(const IntPose& pose) const;
+
+private:
+    const Problem& prob_;
+
+    // The ends of each edge, and the range of its squared length.
+    std::vector<int32_t> us_;
+    std::vector<int32_t> vs_;
+    std::vector<int64_t> min_norms_;
+    std::vector<int64_t> max_norms_;
+};
+
+PoseValidator::PoseValidator(const Problem* prob)
+    : prob_(*prob)
+{
+    const std::vector<Complex>& orig = prob_.vertices();
+
+    for (const Edge& e : prob_.edges()) {
+        // Exact in integers, as the figure is: |d - d_orig| * 10^6 must be at
+        // most epsilon * d_orig.
+        const int64_t d_orig = std::llround(std::norm(orig[e.u] - orig[e.v]));
+        const int64_t slack = prob_.epsilon() * d_orig / static_cast<int64_t>(kEpsDivisor);
+        us_.push_back(e.u);
+        vs_.push_back(e.v);
+        min_norms_.push_back(d_orig - slack);
+        max_norms_.push_back(d_orig + slack);
+    }
+}
+
+bool PoseValidator::Validate(const IntPose& pose) const
+{
+    const int m = us_.size();
+    const int32_t* const x = pose.x.data();
+    const int32_t* const y = pose.y.data();
+
+    int invalid = 0;
+    for (int k = 0; k < m; k++) {
+        const int64_t dx = x[us_[k]] - int64_t{x[vs_[k]]};
+        const int64_t dy = y[us_[k]] - int64_t{y[vs_[k]]};
+        const int64_t d = dx * dx + dy * dy;
+        invalid |= (d < min_norms_[k]) | (d > max_norms_[k]);
+    }
+    if (invalid) return false;
+
+    const Hole& hole = prob_.hole();
+    for (int k = 0; k < m; k++) {
+        if (!hole.Contains(LineSeg{pose[us_[k]], pose[vs_[k]]})) return false;
+    }
+    return true;
+}
+
+#endif  // YUIZUMI_INT_POSE_H_
@@ -0,0 +1,376 @@
+#ifndef YUIZUMI_JSON_READER_H_
+#define YUIZUMI_JSON_READER_H_
+
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "v2.h"
+
+// Reads problems and poses straight from their text, with no Json in
+// between.  The syntax is that of JSON, strictly.  Malformed input throws the
+// exceptions of Json: parse_error for the syntax, out_of_range for a missing
+// key or a number out of range, and type_error for a value of a wrong type.
+
+
+//------------------------
+//  JsonReader
+
+class JsonReader
+{
+public:
+    // The text must outlive the reader.
+    explicit JsonReader(const std::string& text)
+        : begin_(text.data()), p_(begin_), end_(begin_ + text.size()) {}
+
+    // Fails unless only spaces remain.
+    void ExpectEnd();
+
+    int ReadInt();
+    Complex ReadPoint();
+    std::vector<Complex> ReadPoints();
+
+    // Skips any value.
+    void Skip();
+
+    // Calls func() on each element of an array.
+    template <typename Func> void ReadArray(Func func);
+
+    // Calls func(key) on each member of an object.
+    template <typename Func> void ReadObject(Func func);
+
+    // Same, on the whole text, which must be an object; any other value is
+    // read through first, as Json::parse() would, then fails as Json::at().
+    template <typename Func> void ReadRootObject(Func func);
+
+    [[noreturn]] static void KeyNotFound(const char* key)
+    {
+        throw Json::out_of_range::create(
+            403, std::string("key '") + key + "' not found");
+    }
+
+private:
+    char Peek()
+    {
+        while (p_ != end_ && *p_ != '\0' && std::strchr(" \t\n\r", *p_) != nullptr) ++p_;
+        return (p_ != end_) ? *p_ : '\0';
+    }
+
+    void Expect(char c);
+    bool Consume(char c);
+
+    std::string ReadString();
+    bool ScanNumber();
+    double ToDouble(const char* first) const;
+    void SkipNumber();
+    void SkipLiteral(const char* literal);
+
+    // Of the value starting with c.
+    static const char* TypeName(char c);
+
+    [[noreturn]] void Fail(const std::string& message) const
+    {
+        throw Json::parse_error::create(
+            101, p_ - begin_ + 1, "syntax error - " + message);
+    }
+
+    const char* begin_;
+    const char* p_;
+    const char* end_;
+};
+
+void JsonReader::ExpectEnd()
+{
+    Peek();
+    if (p_ != end_) Fail("expected end of input");
+}
+
+void JsonReader::Expect(char c)
+{
+    if (Peek() != c) Fail(std::string("expected '") + c + "'");
+    ++p_;
+}
+
+bool JsonReader::Consume(char c)
+{
+    if (Peek() != c) return false;
+    ++p_;
+    return true;
+}
+
+const char* JsonReader::TypeName(char c)
+{
+    switch (c) {
+        case '"': return "string";
+        case '[': return "array";
+        case '{': return "object";
+        case 't': case 'f': return "boolean";
+        case 'n': return "null";
+        default: return "number";
+    }
+}
+
+int JsonReader::ReadInt()
+{
+    const char c = Peek();
+
+    if (c == '-' || ('0' <= c && c <= '9')) {
+        const char* first = p_;
+        const bool integer = ScanNumber();
+
+        // Short integers are read here; anything else goes through strtod().
+        const bool negative = (c == '-');
+        if (integer && p_ - first - negative <= 9) {
+            int value = 0;
+            for (const char* q = first + negative; q != p_; q++) value = value * 10 + (*q - '0');
+            return negative ? -value : value;
+        }
+
+        const double number = ToDouble(first);
+        if (!(INT_MIN <= number && number <= INT_MAX)) {
+            throw Json::out_of_range::create(
+                406, "number overflow parsing '" + std::string(first, p_) + "'");
+        }
+        return static_cast<int>(number);
+    }
+
+    if (std::strchr("\"[{tfn", c) == nullptr || c == '\0') Fail("expected a value");
+    throw Json::type_error::create(
+        302, std::string("type must be number, but is ") + TypeName(c));
+}
+
+Complex JsonReader::ReadPoint()
+{
+    Expect('[');
+    const int x = ReadInt();
+    Expect(',');
+    const int y = ReadInt();
+    Expect(']');
+    return Complex(x, y);
+}
+
+std::vector<Complex> JsonReader::ReadPoints()
+{
+    std::vector<Complex> points;
+    ReadArray([&] { points.push_back(ReadPoint()); });
+    return points;
+}
+
+template <typename Func> void JsonReader::ReadArray(Func func)
+{
+    Expect('[');
+    if (Consume(']')) return;
+    do {
+        func();
+    } while (Consume(','));
+    Expect(']');
+}
+
+template <typename Func> void JsonReader::ReadRootObject(Func func)
+{
+    const char c = Peek();
+    if (c != '{') {
+        Skip();
+        ExpectEnd();
+        throw Json::type_error::create(
+            304, std::string("cannot use at() with ") + TypeName(c));
+    }
+    ReadObject(func);
+    ExpectEnd();
+}
+
+template <typename Func> void JsonReader::ReadObject(Func func)
+{
+    Expect('{');
+    if (Consume('}')) return;
+    do {
+        const std::string key = ReadString();
+        Expect(':');
+        func(key);
+    } while (Consume(','));
+    Expect('}');
+}
+
+std::string JsonReader::ReadString()
+{
+    Expect('"');
+    std::string s;
+    while (p_ != end_ && *p_ != '"') {
+        if (static_cast<unsigned char>(*p_) < 0x20)
+            Fail("invalid string: control character must be escaped");
+        if (*p_ != '\\') {
+            s += *p_++;
+            continue;
+        }
+        // The keys in our schemas have no escapes, so they are checked but
+        // kept as they are.
+        if (++p_ == end_) break;
+        if (std::strchr("\"\\/bfnrtu", *p_) == nullptr || *p_ == '\0')
+            Fail("invalid string: forbidden character after backslash");
+        if (*p_ == 'u') {
+            for (int i = 1; i <= 4; i++) {
+                if (end_ - p_ <= i || !std::isxdigit(static_cast<unsigned char>(p_[i])))
+                    Fail("invalid string: '\\u' must be followed by 4 hex digits");
+            }
+        }
+        s += *p_++;
+    }
+    if (p_ == end_) Fail("unterminated string");
+    ++p_;
+    return s;
+}
+
+// Moves past a number, as JSON has it:
+//
+//   -? (0 | [1-9][0-9]*) (.[0-9]+)? ([eE][+-]?[0-9]+)?
+//
+// and returns whether it is an integer, with neither a fraction nor an
+// exponent.  What follows the number is up to the caller.
+bool JsonReader::ScanNumber()
+{
+    const auto is_digit = [&] { return p_ != end_ && '0' <= *p_ && *p_ <= '9'; };
+    const auto digits = [&] {
+        if (!is_digit()) Fail("invalid number");
+        while (is_digit()) ++p_;
+    };
+
+    bool integer = true;
+    if (p_ != end_ && *p_ == '-') ++p_;
+    if (p_ != end_ && *p_ == '0') ++p_; else digits();
+    if (p_ != end_ && *p_ == '.') {
+        ++p_;
+        digits();
+        integer = false;
+    }
+    if (p_ != end_ && (*p_ == 'e' || *p_ == 'E')) {
+        ++p_;
+        if (p_ != end_ && (*p_ == '+' || *p_ == '-')) ++p_;
+        digits();
+        integer = false;
+    }
+    return integer;
+}
+
+// Of the number from first to p_, scanned already.
+double JsonReader::ToDouble(const char* first) const
+{
+    const std::string token(first, p_);
+    const double number = std::strtod(token.c_str(), nullptr);
+    if (std::isinf(number)) {
+        throw Json::out_of_range::create(
+            406, "number overflow parsing '" + token + "'");
+    }
+    return number;
+}
+
+void JsonReader::SkipNumber()
+{
+    const char* first = p_;
+    // Out of range even if skipped, as in Json::parse().
+    if (!ScanNumber() || p_ - first > 9) ToDouble(first);
+}
+
+void JsonReader::SkipLiteral(const char* literal)
+{
+    for (const char* q = literal; *q != '\0'; q++) {
+        if (p_ == end_ || *p_ != *q) Fail("invalid literal");
+        ++p_;
+    }
+}
+
+void JsonReader::Skip()
+{
+    switch (Peek()) {
+        case '{': ReadObject([&](const std::string&) { Skip(); }); break;
+        case '[': ReadArray([&] { Skip(); }); break;
+        case '"': ReadString(); break;
+        case 't': SkipLiteral("true"); break;
+        case 'f': SkipLiteral("false"); break;
+        case 'n': SkipLiteral("null"); break;
+        case '\0': Fail("expected a value");
+        default: SkipNumber(); break;
+    }
+}
+
+
+//------------------------
+//  Schemas
+
+Figure ReadFigure(JsonReader& reader)
+{
+    Figure figure;
+    bool has_vertices = false, has_edges = false;
+
+    reader.ReadObject([&](const std::string& key) {
+        if (key == "vertices") {
+            figure.vertices = reader.ReadPoints();
+            has_vertices = true;
+        } else if (key == "edges") {
+            reader.ReadArray([&] {
+                const Complex uv = reader.ReadPoint();
+                figure.edges.push_back({static_cast<int>(uv.real()),
+                                        static_cast<int>(uv.imag())});
+            });
+            has_edges = true;
+        } else {
+            reader.Skip();
+        }
+    });
+
+    if (!has_vertices) JsonReader::KeyNotFound("vertices");
+    if (!has_edges) JsonReader::KeyNotFound("edges");
+    return figure;
+}
+
+Problem ReadProblem(const std::string& text)
+{
+    JsonReader reader(text);
+    std::vector<Complex> hole;
+    Figure figure;
+    int epsilon = 0;
+    bool has_hole = false, has_figure = false, has_epsilon = false;
+
+    reader.ReadRootObject([&](const std::string& key) {
+        if (key == "hole") {
+            hole = reader.ReadPoints();
+            has_hole = true;
+        } else if (key == "figure") {
+            figure = ReadFigure(reader);
+            has_figure = true;
+        } else if (key == "epsilon") {
+            epsilon = reader.ReadInt();
+            has_epsilon = true;
+        } else {
+            reader.Skip();
+        }
+    });
+
+    if (!has_hole) JsonReader::KeyNotFound("hole");
+    if (!has_figure) JsonReader::KeyNotFound("figure");
+    if (!has_epsilon) JsonReader::KeyNotFound("epsilon");
+    return Problem(std::move(hole), std::move(figure), epsilon);
+}
+
+Pose ReadPose(const std::string& text)
+{
+    JsonReader reader(text);
+    Pose pose;
+    bool has_vertices = false;
+
+    reader.ReadRootObject([&](const std::string& key) {
+        if (key == "vertices") {
+            pose = reader.ReadPoints();
+            has_vertices = true;
+        } else {
+            reader.Skip();
+        }
+    });
+
+    if (!has_vertices) JsonReader::KeyNotFound("vertices");
+    return pose;
+}
+
+#endif  // YUIZUMI_JSON_READER_H_
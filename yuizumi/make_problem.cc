@@ -0,0 +1,492 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "v2.h"
+
+namespace {
+
+using namespace std;
+
+// Up to which the planted pose is checked by Validate(), building the grid
+// of the hole.
+constexpr int kMaxGridBoxSize = 2000;
+
+
+//------------------------
+//  Config
+
+struct Config
+{
+    uint32_t seed = mt19937::default_seed;
+
+    // The hole: a polygon of up to hole_vertices, star-shaped around the
+    // center of the box [0, box_size]^2, whose vertices are pulled in by up
+    // to concavity (0 for a convex one, up to 1) of the radius.
+    int box_size = 100;
+    int hole_vertices = 12;
+    double concavity = 0.5;
+
+    // The figure: "mesh" (a square lattice), "tree" or "chains" (paths from
+    // the vertices already placed, as in most problems of the contest).
+    string structure = "chains";
+    int figure_vertices = 50;
+    int num_chains = 5;
+    // Of the edges; computed from the area of the hole if 0.
+    int edge_length = 0;
+
+    int epsilon = 0;
+
+    static Config FromJson(const Json& json);
+};
+
+Config Config::FromJson(const Json& json)
+{
+    Config config;
+
+    if (json.contains("seed")) {
+        config.seed = json.at("seed").get<uint32_t>();
+    }
+
+    if (json.contains("box_size")) {
+        config.box_size = json.at("box_size").get<int>();
+    }
+    if (json.contains("hole_vertices")) {
+        config.hole_vertices = json.at("hole_vertices").get<int>();
+    }
+    if (json.contains("concavity")) {
+        config.concavity = json.at("concavity").get<double>();
+    }
+
+    if (json.contains("structure")) {
+        config.structure = json.at("structure").get<string>();
+    }
+    if (json.contains("figure_vertices")) {
+        config.figure_vertices = json.at("figure_vertices").get<int>();
+    }
+    if (json.contains("num_chains")) {
+        config.num_chains = json.at("num_chains").get<int>();
+    }
+    if (json.contains("edge_length")) {
+        config.edge_length = json.at("edge_length").get<int>();
+    }
+
+    if (json.contains("epsilon")) {
+        config.epsilon = json.at("epsilon").get<int>();
+    }
+
+    return config;
+}
+
+
+//------------------------
+//  Hole
+
+inline double Cross(Complex z1, Complex z2) { return imag(conj(z1) * z2); }
+
+// A star-shaped polygon around center, for which a point is strictly inside
+// if the segment from the center does not meet the border.  The generator
+// keeps everything strictly inside, so the planted pose never touches the
+// border; this avoids building the grid of Hole, too slow for large boxes.
+class StarHole
+{
+public:
+    StarHole(Complex center, vector<Complex> vertices)
+        : center_(center), vertices_(move(vertices))
+    {
+        for (int i = 0; i < vertices_.size(); i++)
+            borders_.push_back({vertices_[i], vertices_[(i + 1) % vertices_.size()]});
+    }
+
+    Complex center() const { return center_; }
+    const vector<Complex>& vertices() const { return vertices_; }
+
+    bool Inside(Complex z) const { return Inside(LineSeg{center_, z}); }
+
+    // Requires z1 strictly inside.
+    bool Inside(const LineSeg& line) const
+    {
+        return all_of(borders_.begin(), borders_.end(), [&](const LineSeg& b) {
+            return Intersects(line, b) == kSeparate;
+        });
+    }
+
+    // Whether the border goes once around the center, turning left at each
+    // vertex as seen from it, so that the center is strictly inside.
+    bool Surrounds() const
+    {
+        double winding = 0.0;
+        for (const LineSeg& b : borders_) {
+            if (Cross(b.z1 - center_, b.z2 - center_) <= 0.0) return false;
+            winding += arg((b.z2 - center_) / (b.z1 - center_));
+        }
+        return abs(winding - 2.0 * M_PI) < 1e-6;
+    }
+
+    double Area() const
+    {
+        double area = 0.0;
+        for (const LineSeg& b : borders_) area += Cross(b.z1, b.z2);
+        return abs(area) / 2.0;
+    }
+
+private:
+    Complex center_;
+    vector<Complex> vertices_;
+    vector<LineSeg> borders_;
+};
+
+optional<StarHole> TryMakeHole(const Config& cfg, mt19937& rng)
+{
+    uniform_real_distribution<double> unif(0.0, 1.0);
+
+    const int n = max(cfg.hole_vertices, 3);
+    const Complex center(cfg.box_size / 2, cfg.box_size / 2);
+    const double radius = cfg.box_size / 2;
+
+    vector<Complex> vertices;
+    for (int i = 0; i < n; i++) {
+        // Jittered within its own slot, so the angles keep increasing; kept
+        // off the center even after rounding.
+        const double theta = 2.0 * M_PI * (i + 0.8 * unif(rng)) / n;
+        const double r = max(2.0, radius * (1.0 - cfg.concavity * unif(rng)));
+        const Complex z = center + polar(r, theta);
+        vertices.emplace_back(round(z.real()), round(z.imag()));
+    }
+
+    // Rounding may break the order around the center; drop such vertices.
+    for (bool changed = true; changed && vertices.size() > 3; ) {
+        changed = false;
+        for (int i = 0; i < vertices.size() && vertices.size() > 3; i++) {
+            const Complex z1 = vertices[(i + vertices.size() - 1) % vertices.size()];
+            const Complex z2 = vertices[i];
+            const Complex z3 = vertices[(i + 1) % vertices.size()];
+            if (Cross(z2 - center, z3 - center) <= 0.0 || z1 == z2) {
+                vertices.erase(vertices.begin() + i);
+                changed = true;
+            }
+        }
+    }
+
+    // With vertices dropped, the rest may no longer go around the center.
+    StarHole hole(center, move(vertices));
+    if (!hole.Surrounds()) return nullopt;
+    return hole;
+}
+
+optional<StarHole> MakeHole(const Config& cfg, mt19937& rng)
+{
+    static constexpr int kMaxTries = 100;
+
+    for (int i = 0; i < kMaxTries; i++) {
+        if (optional<StarHole> hole = TryMakeHole(cfg, rng)) return hole;
+    }
+    return nullopt;
+}
+
+
+//------------------------
+//  Figure
+
+// The planted pose and the edges between its vertices.
+class FigureBuilder
+{
+public:
+    FigureBuilder(const StarHole& hole, mt19937& rng) : hole_(hole), rng_(rng) {}
+
+    const Pose& pose() const { return pose_; }
+    const vector<Edge>& edges() const { return edges_; }
+
+    bool Has(Complex z) const { return index_.count(z); }
+
+    int Add(Complex z)
+    {
+        index_.emplace(z, pose_.size());
+        pose_.push_back(z);
+        return pose_.size() - 1;
+    }
+
+    optional<int> Find(Complex z) const
+    {
+        const auto iter = index_.find(z);
+        if (iter == index_.end()) return nullopt;
+        return iter->second;
+    }
+
+    void Connect(int u, int v) { edges_.push_back({u, v}); }
+
+    bool CanConnect(Complex z1, Complex z2) const
+    {
+        return hole_.Inside(LineSeg{z1, z2});
+    }
+
+    // Tries a new vertex at a random distance in [length / 2, length] from
+    // the vertex u.
+    optional<int> Grow(int u, int length)
+    {
+        static constexpr int kMaxTries = 50;
+
+        uniform_real_distribution<double> unif(0.0, 1.0);
+        const Complex from = pose_[u];
+
+        for (int i = 0; i < kMaxTries; i++) {
+            const double r = length * (0.5 + 0.5 * unif(rng_));
+            const Complex d = polar(r, 2.0 * M_PI * unif(rng_));
+            const Complex z(round(from.real() + d.real()),
+                            round(from.imag() + d.imag()));
+            if (z == from || Has(z) || !hole_.Inside(z)) continue;
+            if (!CanConnect(from, z)) continue;
+            const int v = Add(z);
+            Connect(u, v);
+            return v;
+        }
+        return nullopt;
+    }
+
+private:
+    const StarHole& hole_;
+    mt19937& rng_;
+    Pose pose_;
+    vector<Edge> edges_;
+    unordered_map<Complex, int> index_;
+};
+
+void MakeMesh(FigureBuilder& builder, int n, int length)
+{
+    static constexpr int kDx[] = {1, 0, -1, 0};
+    static constexpr int kDy[] = {0, 1, 0, -1};
+
+    // Breadth-first over the lattice from the center, so the mesh is compact
+    // and connected.
+    queue<int> todo;
+    todo.push(0);
+    while (!todo.empty() && builder.pose().size() < n) {
+        const int u = todo.front();
+        todo.pop();
+        const Complex zu = builder.pose()[u];
+        for (int k = 0; k < 4 && builder.pose().size() < n; k++) {
+            const Complex z = zu + Complex(kDx[k] * length, kDy[k] * length);
+            if (builder.Has(z) || !builder.CanConnect(zu, z)) continue;
+            const int v = builder.Add(z);
+            todo.push(v);
+            // With all the neighbors already there.
+            for (int j = 0; j < 4; j++) {
+                const Complex w = z + Complex(kDx[j] * length, kDy[j] * length);
+                const optional<int> iw = builder.Find(w);
+                if (iw.has_value() && builder.CanConnect(z, w))
+                    builder.Connect(*iw, v);
+            }
+        }
+    }
+}
+
+void MakeTree(FigureBuilder& builder, int n, int length, mt19937& rng)
+{
+    const int max_failures = 100 * n;
+
+    for (int failures = 0; builder.pose().size() < n && failures < max_failures; ) {
+        const int u = uniform_int_distribution<int>(0, builder.pose().size() - 1)(rng);
+        if (!builder.Grow(u, length).has_value()) ++failures;
+    }
+}
+
+void MakeChains(FigureBuilder& builder, int n, int num_chains, int length,
+                mt19937& rng)
+{
+    const int chain_size = max(1, (n - 1) / max(num_chains, 1));
+    const int max_failures = 100 * n;
+
+    int u = 0, size = 0;
+    for (int failures = 0; builder.pose().size() < n && failures < max_failures; ) {
+        if (size == chain_size) {
+            // Branch out from anywhere placed so far.
+            u = uniform_int_distribution<int>(0, builder.pose().size() - 1)(rng);
+            size = 0;
+        }
+        const optional<int> v = builder.Grow(u, length);
+        if (v.has_value()) {
+            u = *v;
+            ++size;
+        } else {
+            ++failures;
+            size = chain_size;
+        }
+    }
+}
+
+
+//------------------------
+//  Problem
+
+// The planted pose moved by a rotation of 90 degrees, a reflection and a
+// translation, which keep the lengths; then each vertex is moved by up to 2
+// in x and y, if the lengths of its edges stay within the epsilon.
+vector<Complex> MakeFigureVertices(const Pose& pose, const vector<Edge>& edges,
+                                   int epsilon, mt19937& rng)
+{
+    vector<Complex> vertices(pose.size());
+
+    const int turns = uniform_int_distribution<int>(0, 3)(rng);
+    const bool mirror = uniform_int_distribution<int>(0, 1)(rng);
+    for (int i = 0; i < pose.size(); i++) {
+        Complex z = pose[i];
+        for (int k = 0; k < turns; k++) z *= Complex(0, 1);
+        if (mirror) z = conj(z);
+        vertices[i] = z;
+    }
+
+    if (epsilon > 0) {
+        vector<vector<int>> adj(pose.size());
+        for (const Edge& e : edges) {
+            adj[e.u].push_back(e.v);
+            adj[e.v].push_back(e.u);
+        }
+        const auto valid = [&](int u) {
+            return all_of(adj[u].begin(), adj[u].end(), [&](int v) {
+                const double d_pose = norm(pose[u] - pose[v]);
+                const double d_orig = norm(vertices[u] - vertices[v]);
+                return abs(d_pose - d_orig) * kEpsDivisor <= epsilon * d_orig;
+            });
+        };
+
+        unordered_set<Complex> used(vertices.begin(), vertices.end());
+        uniform_int_distribution<int> offset(-2, 2);
+        for (int u = 0; u < vertices.size(); u++) {
+            const Complex z = vertices[u];
+            const Complex moved = z + Complex(offset(rng), offset(rng));
+            if (used.count(moved)) continue;
+            vertices[u] = moved;
+            if (valid(u)) {
+                used.erase(z);
+                used.insert(moved);
+            } else {
+                vertices[u] = z;
+            }
+        }
+    }
+
+    double xmin = kInf, ymin = kInf;
+    for (const Complex z : vertices) {
+        xmin = min(xmin, z.real());
+        ymin = min(ymin, z.imag());
+    }
+    for (Complex& z : vertices) z -= Complex(xmin, ymin);
+
+    return vertices;
+}
+
+// Same as Validate() on the problem, without the grid of Hole, which is too
+// large for large boxes: every vertex and edge of the pose strictly inside
+// the hole, as the generator keeps them.
+bool IsValidPlanted(const StarHole& hole, const Pose& pose, const vector<Edge>& edges,
+                    const vector<Complex>& orig, int epsilon)
+{
+    if (!all_of(pose.begin(), pose.end(), [&](Complex z) { return hole.Inside(z); }))
+        return false;
+
+    return all_of(edges.begin(), edges.end(), [&](const Edge& e) {
+        const double d_pose = norm(pose[e.u] - pose[e.v]);
+        const double d_orig = norm(orig[e.u] - orig[e.v]);
+        return abs(d_pose - d_orig) * kEpsDivisor <= epsilon * d_orig
+            && hole.Inside(LineSeg{pose[e.u], pose[e.v]});
+    });
+}
+
+Json VerticesToJson(const vector<Complex>& vertices)
+{
+    Json json = Json::array();
+    for (const Complex z : vertices) {
+        json.push_back({static_cast<int>(z.real()), static_cast<int>(z.imag())});
+    }
+    return json;
+}
+
+}  // namespace
+
+//------------------------
+//  Entrypoint
+
+// Writes a problem and a valid pose of it.
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        cerr << "Usage: make_problem PROBLEM POSE [CONFIG]" << endl;
+        return 1;
+    }
+
+    Config cfg;
+    if (argc >= 4) cfg = Config::FromJson(Json::parse(argv[3]));
+
+    mt19937 rng(cfg.seed);
+
+    const optional<StarHole> made = MakeHole(cfg, rng);
+    if (!made.has_value()) {
+        cerr << "failed to make a hole around the center" << endl;
+        return 1;
+    }
+    const StarHole& hole = *made;
+
+    int length = cfg.edge_length;
+    if (length <= 0) {
+        // About half of the hole covered by a mesh, or spread over by the
+        // other figures.
+        const double area = hole.Area() / max(cfg.figure_vertices, 1);
+        length = max(1, static_cast<int>(sqrt(area / 2.0)));
+    }
+
+    FigureBuilder builder(hole, rng);
+    builder.Add(hole.center());
+
+    if (cfg.structure == "mesh") {
+        MakeMesh(builder, cfg.figure_vertices, length);
+    } else if (cfg.structure == "tree") {
+        MakeTree(builder, cfg.figure_vertices, length, rng);
+    } else if (cfg.structure == "chains") {
+        MakeChains(builder, cfg.figure_vertices, cfg.num_chains, length, rng);
+    } else {
+        cerr << cfg.structure << ": unknown structure" << endl;
+        return 1;
+    }
+
+    const Pose& pose = builder.pose();
+    const vector<Edge>& edges = builder.edges();
+
+    cerr << "hole: " << hole.vertices().size() << " vertices, figure: "
+         << pose.size() << " vertices, " << edges.size() << " edges" << endl;
+
+    const vector<Complex> figure_vertices =
+        MakeFigureVertices(pose, edges, cfg.epsilon, rng);
+
+    Json figure;
+    figure["vertices"] = VerticesToJson(figure_vertices);
+    figure["edges"] = Json::array();
+    for (const Edge& e : edges) figure["edges"].push_back({e.u, e.v});
+
+    Json problem;
+    problem["bonuses"] = Json::array();
+    problem["hole"] = VerticesToJson(hole.vertices());
+    problem["epsilon"] = cfg.epsilon;
+    problem["figure"] = figure;
+
+    // Never written unless the planted pose is a known solution indeed.
+    const bool valid = (cfg.box_size <= kMaxGridBoxSize)
+        ? Validate(Problem::FromJson(problem), pose)
+        : IsValidPlanted(hole, pose, edges, figure_vertices, cfg.epsilon);
+    if (!valid) {
+        cerr << "the planted pose is not valid" << endl;
+        return 1;
+    }
+
+    ofstream(argv[1]) << problem << endl;
+    ofstream(argv[2]) << PoseToJson(pose) << endl;
+
+    return 0;
+}
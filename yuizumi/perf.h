@@ -0,0 +1,169 @@
+#ifndef YUIZUMI_PERF_H_
+#define YUIZUMI_PERF_H_
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hardware counters by perf_event_open(2), added up for each phase of a run,
+// with -DPERF_COUNTERS only:
+//
+//   PERF_START();
+//   ... work ...
+//   PERF_STOP(PerfPhase::kSearch);
+//   ...
+//   PERF_REPORT();  // on stderr
+//
+// The phases must not nest.  Where the kernel refuses the counters (see
+// /proc/sys/kernel/perf_event_paranoid), the report says so.
+
+#ifdef PERF_COUNTERS
+#define PERF_START() PerfCounters::Get().Start()
+#define PERF_STOP(phase) PerfCounters::Get().Stop(phase)
+#define PERF_REPORT() PerfCounters::Get().Report(std::cerr)
+#else
+#define PERF_START() (void)0
+#define PERF_STOP(phase) (void)0
+#define PERF_REPORT() (void)0
+#endif
+
+enum class PerfPhase
+{
+    kHole,
+    kSearch,
+    kValidate,
+    kDislikes,
+};
+
+constexpr int kNumPerfPhases = 4;
+
+
+//------------------------
+//  PerfCounters
+
+class PerfCounters
+{
+public:
+    static PerfCounters& Get()
+    {
+        static PerfCounters counters;
+        return counters;
+    }
+
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    void Start() { Read(start_); }
+    void Stop(PerfPhase phase);
+
+    void Report(std::ostream& out) const;
+
+private:
+    struct Event { const char* name; uint64_t config; };
+
+    static constexpr Event kEvents[] = {
+        {"cycles", PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_COUNT_HW_INSTRUCTIONS},
+        {"cache_misses", PERF_COUNT_HW_CACHE_MISSES},
+        {"branch_misses", PERF_COUNT_HW_BRANCH_MISSES},
+    };
+
+    PerfCounters();
+
+    bool Read(std::vector<uint64_t>& values) const;
+
+    // The first one leads the group; the events opened, by their indices.
+    std::vector<int> fds_;
+    std::vector<int> opened_;
+
+    std::vector<uint64_t> start_;
+    std::vector<uint64_t> totals_[kNumPerfPhases];
+    long calls_[kNumPerfPhases] = {};
+};
+
+PerfCounters::PerfCounters()
+{
+    for (int k = 0; k < std::size(kEvents); k++) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = kEvents[k].config;
+        attr.disabled = fds_.empty();
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        const int group = fds_.empty() ? -1 : fds_.front();
+        const int fd = syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+        if (fd < 0) continue;
+        fds_.push_back(fd);
+        opened_.push_back(k);
+    }
+
+    for (std::vector<uint64_t>& totals : totals_) totals.assign(fds_.size(), 0);
+    start_.assign(fds_.size(), 0);
+
+    if (!fds_.empty())
+        ioctl(fds_.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (const int fd : fds_) close(fd);
+}
+
+bool PerfCounters::Read(std::vector<uint64_t>& values) const
+{
+    if (fds_.empty()) return false;
+
+    // nr, then the values in the order opened.
+    uint64_t buf[1 + std::size(kEvents)];
+    if (read(fds_.front(), buf, sizeof(buf)) < 0) return false;
+    for (int i = 0; i < fds_.size(); i++) values[i] = buf[1 + i];
+    return true;
+}
+
+void PerfCounters::Stop(PerfPhase phase)
+{
+    const int p = static_cast<int>(phase);
+    std::vector<uint64_t> now(fds_.size());
+    if (!Read(now)) return;
+    for (int i = 0; i < fds_.size(); i++) totals_[p][i] += now[i] - start_[i];
+    ++calls_[p];
+}
+
+void PerfCounters::Report(std::ostream& out) const
+{
+    static constexpr const char* kPhaseNames[] = {
+        "hole", "search", "validate", "dislikes",
+    };
+
+    if (fds_.empty()) {
+        out << "perf: counters unavailable" << std::endl;
+        return;
+    }
+
+    for (int p = 0; p < kNumPerfPhases; p++) {
+        if (calls_[p] == 0) continue;
+        out << "perf " << kPhaseNames[p] << " (" << calls_[p] << "x):";
+        for (int i = 0; i < fds_.size(); i++)
+            out << " " << kEvents[opened_[i]].name << "=" << totals_[p][i];
+        // Instructions per cycle, if both are counted.
+        if (opened_.size() >= 2 && opened_[0] == 0 && opened_[1] == 1
+            && totals_[p][0] > 0)
+            out << " ipc=" << static_cast<double>(totals_[p][1]) / totals_[p][0];
+        out << std::endl;
+    }
+}
+
+#endif  // YUIZUMI_PERF_H_
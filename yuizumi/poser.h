@@ -0,0 +1,1084 @@
+#ifndef YUIZUMI_POSER_H_
+#define YUIZUMI_POSER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "v2.h"
+#include "chain.h"
+#include "figure_graph.h"
+#include "hole_table.h"
+#include "trace.h"
+#include "alloc_count.h"
+
+//------------------------
+//  PoserStats
+
+// Counters of the search, compiled in with -DPOSER_STATS only.
+#ifdef POSER_STATS
+#define POSER_COUNT(expr) (void)(expr)
+#else
+#define POSER_COUNT(expr) (void)0
+#endif
+
+// Events of the search, recorded with -DPOSER_TRACE only; see trace.h.
+#ifdef POSER_TRACE
+#define POSER_TRACE_EVENT(...) trace_.Record(__VA_ARGS__)
+#else
+#define POSER_TRACE_EVENT(...) (void)0
+#endif
+
+struct PoserStats
+{
+    long make_pose = 0;
+    long made = 0;
+    long steps = 0;
+    long max_steps = 0;
+    long out_of_steps = 0;
+
+    long locate_hole = 0;
+    long locate_hole_none = 0;
+    long locate_deg0 = 0;
+    long locate_deg1 = 0;
+    long locate_deg2 = 0;
+    long locate_deg2_none = 0;
+
+    long reject_duplicate = 0;
+    long reject_length = 0;
+    long reject_containment = 0;
+    long reject_table = 0;
+
+    long chain_placed = 0;
+    long chain_unreachable = 0;
+    long chain_too_expensive = 0;
+    long chain_duplicate = 0;
+
+    // By the index in the order of placement.
+    std::vector<long> backtracks;
+
+    Json ToJson() const;
+};
+
+Json PoserStats::ToJson() const
+{
+    // Drops the zeros at the deep end.
+    std::vector<long> depths = backtracks;
+    while (!depths.empty() && depths.back() == 0) depths.pop_back();
+
+    return {
+        {"make_pose", {{"calls", make_pose}, {"made", made},
+                       {"steps", steps}, {"max_steps", max_steps},
+                       {"out_of_steps", out_of_steps}}},
+        {"locate", {{"hole", locate_hole}, {"hole_none", locate_hole_none},
+                    {"deg0", locate_deg0}, {"deg1", locate_deg1},
+                    {"deg2", locate_deg2}, {"deg2_none", locate_deg2_none}}},
+        {"reject", {{"duplicate", reject_duplicate}, {"length", reject_length},
+                    {"containment", reject_containment},
+                    {"table", reject_table}}},
+        {"chain", {{"placed", chain_placed}, {"unreachable", chain_unreachable},
+                   {"too_expensive", chain_too_expensive},
+                   {"duplicate", chain_duplicate}}},
+        {"backtracks", depths},
+    };
+}
+
+
+//------------------------
+//  Random
+
+class Random
+{
+public:
+    explicit Random(uint_fast32_t seed) : rng_(seed) {}
+
+    std::mt19937& rng() { return rng_; }
+
+    bool Bernoulli(double prob)
+    {
+        return std::bernoulli_distribution(prob)(rng_);
+    }
+    
+    double Get(double lo, double hi)
+    {
+        return std::uniform_real_distribution<double>(lo, hi)(rng_);
+    }
+
+    int Get(int lo, int hi)
+    {
+        return std::uniform_int_distribution<int>(lo, hi)(rng_);
+    }
+
+private:
+    std::mt19937 rng_;
+};
+
+
+//------------------------
+//  Hint
+
+struct Hint
+{
+    int index;
+    Complex z;
+
+    static Hint FromJson(const Json& json);
+};
+
+Hint Hint::FromJson(const Json& json)
+{
+    return {
+        .index = json[0].get<int>(),
+        .z = Complex(json[1][0].get<int>(), json[1][1].get<int>()),
+    };
+}
+
+
+//------------------------
+//  Config
+
+struct Config
+{
+    std::vector<Hint> hints;
+
+    uint32_t seed = std::mt19937::default_seed;
+
+    double prob_hole = 0.5;
+
+    int num_poses = 5000;
+    int max_total_steps = 50000;
+    int max_local_steps = 25;
+
+    bool use_chains = false;
+    long max_chain_work = 2000000;
+    long max_chain_cells = 1L << 30;
+
+    bool cover_first = false;
+    int max_cover_steps = 10000;
+
+    int population = 0;
+    int num_children = 5000;
+
+    bool polish = false;
+    int polish_radius = 2;
+
+    // Written with -DPOSER_TRACE only.
+    std::string trace_file = "poser.trace";
+
+    static Config FromJson(const Json& json);
+};
+
+Config Config::FromJson(const Json& json)
+{
+    Config config;
+
+    if (json.contains("hints")) {
+        config.hints.reserve(json.at("hints").size());
+        for (const Json& hint : json.at("hints"))
+            config.hints.push_back(Hint::FromJson(hint));
+    }
+
+    if (json.contains("seed")) {
+        config.seed = json.at("seed").get<uint32_t>();
+    }
+
+    if (json.contains("prob_hole")) {
+        config.prob_hole = json.at("prob_hole").get<double>();
+    }
+    if (json.contains("num_poses")) {
+        config.num_poses = json.at("num_poses").get<int>();
+    }
+    if (json.contains("max_total_steps")) {
+        config.max_total_steps = json.at("max_total_steps").get<int>();
+    }
+    if (json.contains("max_local_steps")) {
+        config.max_local_steps = json.at("max_local_steps").get<int>();
+    }
+
+    if (json.contains("use_chains")) {
+        config.use_chains = json.at("use_chains").get<bool>();
+    }
+    if (json.contains("max_chain_work")) {
+        config.max_chain_work = json.at("max_chain_work").get<long>();
+    }
+    if (json.contains("max_chain_cells")) {
+        config.max_chain_cells = json.at("max_chain_cells").get<long>();
+    }
+
+    if (json.contains("cover_first")) {
+        config.cover_first = json.at("cover_first").get<bool>();
+    }
+    if (json.contains("max_cover_steps")) {
+        config.max_cover_steps = json.at("max_cover_steps").get<int>();
+    }
+
+    if (json.contains("population")) {
+        config.population = json.at("population").get<int>();
+    }
+    if (json.contains("num_children")) {
+        config.num_children = json.at("num_children").get<int>();
+    }
+
+    if (json.contains("polish")) {
+        config.polish = json.at("polish").get<bool>();
+    }
+    if (json.contains("polish_radius")) {
+        config.polish_radius = json.at("polish_radius").get<int>();
+    }
+    if (json.contains("trace_file")) {
+        config.trace_file = json.at("trace_file").get<std::string>();
+    }
+
+    return config;
+}
+
+
+//------------------------
+//  Poser
+
+class Poser
+{
+public:
+    Poser(const Problem* prob, const Config* cfg);
+
+    std::optional<Pose> MakePose() { return MakePose(cfg_.hints); }
+    std::optional<Pose> MakePose(const std::vector<Hint>& hints);
+
+    // Makes the pose into the given one, whose storage is reused.  Returns
+    // false on failure, leaving the pose undefined.
+    bool MakePose(const std::vector<Hint>& hints, Pose& pose);
+
+    // Moves single vertices and translates the whole pose as long as that
+    // reduces dislikes, keeping the pose valid.
+    Pose Polish(Pose pose);
+
+    const PoserStats& stats() const { return stats_; }
+
+#ifdef POSER_TRACE
+    const TraceBuffer& trace() const { return trace_; }
+#endif
+
+private:
+    bool PolishVertices(Pose& pose);
+    bool PolishTranslation(Pose& pose);
+
+    // A vertex, or the inner vertices of a chain, being placed at order_[index]
+    // in the search.
+    struct Frame
+    {
+        int index;
+        int chain;  // Or -1, after falling back to one by one.
+        int step;
+        bool placed;
+    };
+
+    bool Search(Pose& pose, int index);
+
+    void Enter(int index);
+    std::optional<int> Advance(Pose& pose, Frame& frame);
+    std::optional<int> AdvanceChain(Pose& pose, Frame& frame);
+    void Retreat(Frame& frame);
+
+    void Prepare(Pose& pose);
+    void PrepareChains();
+    void PrepareCover();
+
+    bool ChooseCover();
+    bool ChooseCover(const std::vector<int>& rest, int index,
+                     std::vector<int>& used);
+    bool IsConsistent(int i, int v) const;
+
+    bool IsFeasible(const Pose& pose, Complex z, int v);
+
+    void Occupy(int v, Complex z);
+    void Vacate(int v);
+
+    std::optional<Complex> LocateHole(const Pose& pose, int v);
+
+    std::optional<Complex> LocateDeg0(const Pose& pose, int v);
+    std::optional<Complex> LocateDeg1(const Pose& pose, const Arc& u);
+    std::optional<Complex> LocateDeg2(const Pose& pose, const Arc& u, const Arc& t);
+
+    std::optional<Complex> Locate(const Pose& pose, int v);
+
+    const Problem& prob_;
+    const Config& cfg_;
+
+    int steps_left_;
+    const FigureGraph graph_;
+    std::vector<int> order_;
+    std::vector<Hint> hints_;
+    Random random_;
+
+    // The neighbors of each vertex placed before it, at the same offsets in
+    // the rows of graph_.
+    std::vector<Arc> preds_;
+    std::vector<int> num_preds_;
+
+    Arcs preds(int v) const { return Arcs(&preds_[graph_.offset(v)], num_preds_[v]); }
+    void AddPred(int v, const Arc& arc) { preds_[graph_.offset(v) + num_preds_[v]++] = arc; }
+
+    // Scratch of Prepare and LocateHole, kept to save allocations.
+    std::vector<Arc> shuffled_;
+    std::vector<char> prepared_;
+    std::vector<int> next_;
+    std::vector<Arc> others_;
+    HoleSet candidates_;
+
+    // Index of the hole vertex at each placed vertex (or -1), and the hole
+    // vertices with some vertex placed on.
+    HoleTable hole_table_;
+    std::vector<int> hole_at_;
+    std::vector<int> occupants_;
+    HoleSet occupied_;
+
+    // Maximal paths whose inner vertices are all of degree 2, and the chain
+    // to be placed at once from each position of order_ (or -1).
+    std::vector<std::vector<int>> chains_;
+    std::vector<int> chain_at_;
+    ChainSolver chain_solver_;
+
+    // The stack of the search, and the positions tried at each index (the
+    // inner vertices of a chain one after another), kept across poses.
+    std::vector<Frame> frames_;
+    std::vector<std::vector<Complex>> tried_;
+
+    // For cover_first: the longest possible distance between each pair of
+    // figure vertices, whether each pair of hole vertices can see each
+    // other, and the figure vertex (or -1) covering each hole vertex.
+    std::vector<std::vector<double>> reach_;
+    std::vector<std::vector<char>> visible_;
+    std::vector<int> cover_;
+    int cover_steps_left_;
+    std::vector<int> cover_used_;
+    std::vector<int> cover_rest_;
+
+    PoserStats stats_;
+    bool warmed_up_ = false;
+
+#ifdef POSER_TRACE
+    TraceBuffer trace_;
+#endif
+};
+
+Poser::Poser(const Problem* prob, const Config* cfg)
+    : prob_(*prob), cfg_(*cfg),
+      graph_(prob),
+      random_(cfg_.seed),
+      candidates_(prob->hole().size()),
+      hole_table_(prob),
+      occupied_(prob->hole().size()),
+      chain_solver_(prob, cfg_.max_chain_work, cfg_.max_chain_cells)
+{
+    const int n = prob_.vertices().size();
+    POSER_COUNT(stats_.backtracks.resize(n));
+
+    // All the storage of the search, up front.
+    preds_.resize(graph_.arcs().size());
+    num_preds_.resize(n);
+    shuffled_.reserve(graph_.arcs().size());
+    others_.reserve(graph_.max_degree());
+    order_.reserve(n);
+    next_.reserve(n);
+    frames_.reserve(n + 1);
+    tried_.resize(n + 1);
+    for (std::vector<Complex>& tried : tried_) tried.reserve(cfg_.max_local_steps);
+    hints_.reserve(n + prob_.hole().size());
+
+    if (cfg_.cover_first) PrepareCover();
+
+    if (!cfg_.use_chains) return;
+
+    std::vector<int> hinted(n);
+    for (const Hint& hint : cfg_.hints) hinted[hint.index] = true;
+
+    const auto is_inner = [&](int v) {
+        return graph_.degree(v) == 2 && !hinted[v];
+    };
+
+    for (int u = 0; u < n; u++) {
+        if (is_inner(u)) continue;
+        for (const Arc& arc : graph_.arcs(u)) {
+            const int first = arc.v;
+            if (!is_inner(first)) continue;
+            std::vector<int> chain = {u, first};
+            while (is_inner(chain.back())) {
+                const Arcs adj = graph_.arcs(chain.back());
+                const int w = chain[chain.size() - 2];
+                chain.push_back(adj[0].v != w ? adj[0].v : adj[1].v);
+            }
+            // Take each chain in one direction only.
+            const int v = chain.back();
+            if (u < v || (u == v && chain[1] < chain[chain.size() - 2]))
+                chains_.push_back(std::move(chain));
+        }
+    }
+}
+
+std::optional<Pose> Poser::MakePose(const std::vector<Hint>& hints)
+{
+    Pose pose;
+    if (MakePose(hints, pose)) return pose;
+    return std::nullopt;
+}
+
+bool Poser::MakePose(const std::vector<Hint>& hints, Pose& pose)
+{
+    // The first call sizes the storage; the rest may not allocate, except
+    // for the chains (whose solver copies the paths and keeps a memo).
+    ASSERT_NO_ALLOCS(warmed_up_ && !cfg_.use_chains);
+
+    pose.resize(prob_.vertices().size());
+    steps_left_ = cfg_.max_total_steps;
+    hints_ = hints;
+    if (cfg_.cover_first && !ChooseCover()) return false;
+    Prepare(pose);
+    POSER_TRACE_EVENT(TraceKind::kBegin, TraceResult::kNone, hints_.size(), 0);
+    const bool made = Search(pose, hints_.size());
+    warmed_up_ = true;
+    POSER_TRACE_EVENT(TraceKind::kEnd,
+                      made ? TraceResult::kMade : TraceResult::kFailed, 0, 0);
+
+#ifdef POSER_STATS
+    const long steps = cfg_.max_total_steps - std::max(steps_left_, 0);
+    ++stats_.make_pose;
+    stats_.made += made;
+    stats_.steps += steps;
+    stats_.max_steps = std::max(stats_.max_steps, steps);
+    stats_.out_of_steps += (steps_left_ < 0);
+#endif
+
+    return made;
+}
+
+void Poser::PrepareCover()
+{
+    const Hole& hole = prob_.hole();
+    const int n = prob_.vertices().size();
+
+    // Dijkstra from each vertex, by the longest valid length of each edge.
+    reach_.assign(n, std::vector<double>(n, kInf));
+
+    for (int s = 0; s < n; s++) {
+        std::vector<double>& dist = reach_[s];
+        using Item = std::pair<double, int>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+        dist[s] = 0.0;
+        queue.emplace(0.0, s);
+        while (!queue.empty()) {
+            const auto [d, u] = queue.top();
+            queue.pop();
+            if (d > dist[u]) continue;
+            for (const auto [v, e] : graph_.arcs(u)) {
+                const double w = d + std::sqrt(graph_.max_norm(e));
+                if (w < dist[v]) queue.emplace(dist[v] = w, v);
+            }
+        }
+    }
+
+    visible_.assign(hole.size(), std::vector<char>(hole.size()));
+
+    for (int i = 0; i < hole.size(); i++)
+    for (int j = 0; j < hole.size(); j++) {
+        visible_[i][j] = hole.Contains(LineSeg{hole[i], hole[j]});
+    }
+}
+
+// Assigns distinct figure vertices to all the hole vertices not covered by
+// the hints yet, and adds them to hints_.
+bool Poser::ChooseCover()
+{
+    const Hole& hole = prob_.hole();
+    const int n = prob_.vertices().size();
+
+    cover_.assign(hole.size(), -1);
+    std::vector<int>& used = cover_used_;
+    used.assign(n, false);
+
+    for (const Hint& hint : hints_) {
+        used[hint.index] = true;
+        for (int i = 0; i < hole.size(); i++) {
+            if (hole[i] == hint.z) cover_[i] = hint.index;
+        }
+    }
+
+    std::vector<int>& rest = cover_rest_;
+    rest.clear();
+    for (int i = 0; i < hole.size(); i++) {
+        if (cover_[i] == -1) rest.push_back(i);
+    }
+    if (rest.size() > n - hints_.size()) return false;
+    std::shuffle(rest.begin(), rest.end(), random_.rng());
+
+    cover_steps_left_ = cfg_.max_cover_steps;
+    if (!ChooseCover(rest, 0, used)) return false;
+
+    for (const int i : rest) hints_.push_back({cover_[i], hole[i]});
+    return true;
+}
+
+bool Poser::ChooseCover(const std::vector<int>& rest, int index,
+                        std::vector<int>& used)
+{
+    if (index == rest.size()) {
+        return true;
+    }
+
+    const int i = rest[index];
+    const int n = prob_.vertices().size();
+    const int offset = random_.Get(0, n - 1);
+
+    for (int k = 0; k < n; k++) {
+        const int v = (k + offset) % n;
+        if (used[v] || !IsConsistent(i, v)) continue;
+        if (--cover_steps_left_ < 0)
+            return false;
+
+        cover_[i] = v;
+        used[v] = true;
+        if (ChooseCover(rest, index + 1, used)) return true;
+        used[v] = false;
+        cover_[i] = -1;
+    }
+
+    return false;
+}
+
+// Whether the figure vertex v can be on the hole vertex i along with the
+// hints and the cover chosen so far.
+bool Poser::IsConsistent(int i, int v) const
+{
+    const Hole& hole = prob_.hole();
+    const Complex z = hole[i];
+
+    for (int j = 0; j < hole.size(); j++) {
+        const int u = cover_[j];
+        if (u == -1) continue;
+        if (std::abs(hole[j] - z) > reach_[u][v]) return false;
+        if (const int e = graph_.FindEdge(u, v); e != -1) {
+            if (!graph_.IsValidNorm(e, std::norm(hole[j] - z))) return false;
+            if (!visible_[i][j]) return false;
+        }
+    }
+
+    for (const Hint& hint : hints_) {
+        const int u = hint.index;
+        if (std::abs(hint.z - z) > reach_[u][v]) return false;
+        if (const int e = graph_.FindEdge(u, v); e != -1) {
+            if (!graph_.IsValidNorm(e, std::norm(hint.z - z))) return false;
+            if (!hole.Contains(LineSeg{hint.z, z})) return false;
+        }
+    }
+
+    return true;
+}
+
+void Poser::Prepare(Pose& pose)
+{
+    const int n = prob_.vertices().size();
+
+    // Rows of graph_, shuffled below from the same order each time.
+    std::vector<Arc>& adj = shuffled_;
+    adj.assign(graph_.arcs().begin(), graph_.arcs().end());
+    const auto shuffle = [&](int u) {
+        Arc* const row = &adj[graph_.offset(u)];
+        std::shuffle(row, row + graph_.degree(u), random_.rng());
+        return Arcs(row, graph_.degree(u));
+    };
+
+    order_.clear();
+    num_preds_.assign(n, 0);
+
+    std::vector<char>& done = prepared_;
+    done.assign(n, false);
+
+    hole_at_.assign(n, -1);
+    occupants_.assign(prob_.hole().size(), 0);
+    occupied_.Clear();
+
+    for (const Hint& hint : hints_) {
+        const int u = hint.index;
+        pose[u] = hint.z;
+        Occupy(u, hint.z);
+
+        order_.push_back(u);
+
+        for (const auto [v, e] : shuffle(u)) { if (!done[v]) AddPred(v, {u, e}); }
+        done[u] = true;
+    }
+
+    std::vector<int>& next = next_;
+
+    while (order_.size() < n) {
+        int max_deg = -1;
+
+        for (int v = 0; v < n; v++) {
+            const int deg = num_preds_[v];
+            if (!done[v] && deg >= max_deg) {
+                if (deg != max_deg) next.clear();
+                next.push_back(v);
+                max_deg = deg;
+            }
+        }
+
+        const int u = next[random_.Get(0, next.size() - 1)];
+
+        order_.push_back(u);
+
+        for (const auto [v, e] : shuffle(u)) { if (!done[v]) AddPred(v, {u, e}); }
+        done[u] = true;
+    }
+
+    chain_at_.assign(n, -1);
+    if (cfg_.use_chains) PrepareChains();
+}
+
+// Moves the inner vertices of each chain next to each other in order_ if
+// both ends come before them, so they can be placed in a single step.
+void Poser::PrepareChains()
+{
+    const int n = prob_.vertices().size();
+    std::vector<int> pos(n);
+    std::vector<int> moved;
+
+    for (int c = 0; c < chains_.size(); c++) {
+        const std::vector<int>& chain = chains_[c];
+        const int k = chain.size() - 1;
+
+        for (int i = 0; i < n; i++) pos[order_[i]] = i;
+
+        int first = n;
+        for (int i = 1; i < k; i++) first = std::min(first, pos[chain[i]]);
+
+        if (first < hints_.size()) continue;
+        if (pos[chain[0]] > first || pos[chain[k]] > first) continue;
+
+        const auto is_inner = [&](int v) {
+            const auto end = chain.end() - 1;
+            return std::find(chain.begin() + 1, end, v) != end;
+        };
+        order_.erase(std::remove_if(order_.begin() + first, order_.end(), is_inner),
+                     order_.end());
+        order_.insert(order_.begin() + first, chain.begin() + 1, chain.end() - 1);
+
+        for (int i = 1; i < k; i++) {
+            num_preds_[chain[i]] = 0;
+            AddPred(chain[i], {chain[i - 1], graph_.FindEdge(chain[i - 1], chain[i])});
+        }
+        AddPred(chain[k - 1], {chain[k], graph_.FindEdge(chain[k], chain[k - 1])});
+
+        moved.push_back(c);
+    }
+
+    for (int i = 0; i < n; i++) pos[order_[i]] = i;
+    for (const int c : moved) chain_at_[pos[chains_[c][1]]] = c;
+}
+
+bool Poser::IsFeasible(const Pose& pose, Complex z, int v)
+{
+    const int i = hole_table_.Find(z);
+
+    const Arcs adj = preds(v);
+    return std::all_of(adj.begin(), adj.end(), [&](const Arc& arc) {
+        const auto [u, e] = arc;
+        if (i != -1 && hole_at_[u] != -1) {
+            const bool valid = hole_table_.Get(e, hole_at_[u]).Get(i);
+            POSER_COUNT(stats_.reject_table += !valid);
+            return valid;
+        }
+        if (!graph_.IsValidNorm(e, std::norm(pose[u] - z))) {
+            POSER_COUNT(++stats_.reject_length);
+            return false;
+        }
+        if (!prob_.hole().Contains(LineSeg{pose[u], z})) {
+            POSER_COUNT(++stats_.reject_containment);
+            return false;
+        }
+        return true;
+    });
+}
+
+void Poser::Occupy(int v, Complex z)
+{
+    const int i = hole_table_.Find(z);
+    hole_at_[v] = i;
+    if (i != -1 && occupants_[i]++ == 0) occupied_.Set(i);
+}
+
+void Poser::Vacate(int v)
+{
+    const int i = hole_at_[v];
+    hole_at_[v] = -1;
+    if (i != -1 && --occupants_[i] == 0) occupied_.Reset(i);
+}
+
+std::optional<Complex> Poser::LocateHole(const Pose& pose, int v)
+{
+    POSER_COUNT(++stats_.locate_hole);
+
+    const Hole& hole = prob_.hole();
+
+    HoleSet& candidates = candidates_;
+    candidates.Fill();
+    candidates.Subtract(occupied_);
+
+    std::vector<Arc>& others = others_;
+    others.clear();
+    for (const Arc& arc : preds(v)) {
+        if (hole_at_[arc.v] != -1)
+            candidates &= hole_table_.Get(arc.edge, hole_at_[arc.v]);
+        else
+            others.push_back(arc);
+    }
+
+    std::optional<Complex> picked;
+    int count = 0;
+
+    candidates.ForEach([&](int i) {
+        const Complex z = hole[i];
+        const bool feasible = std::all_of(others.begin(), others.end(), [&](const Arc& arc) {
+            return graph_.IsValidNorm(arc.edge, std::norm(pose[arc.v] - z))
+                && hole.Contains(LineSeg{pose[arc.v], z});
+        });
+        if (feasible && random_.Get(0, count++) == 0)
+            picked = z;
+    });
+
+    POSER_COUNT(stats_.locate_hole_none += !picked.has_value());
+    return picked;
+}
+
+std::optional<Complex> Poser::LocateDeg0(const Pose& pose, int v)
+{
+    POSER_COUNT(++stats_.locate_deg0);
+    const Hole& hole = prob_.hole();
+    while (true) {
+        const Complex z(random_.Get(hole.xmin(), hole.xmax()),
+                        random_.Get(hole.ymin(), hole.ymax()));
+        if (hole.Contains(z)) return z;
+    }
+}
+
+std::optional<Complex> Poser::LocateDeg1(const Pose& pose, const Arc& u)
+{
+    POSER_COUNT(++stats_.locate_deg1);
+    const double norm = random_.Get(graph_.min_norm(u.edge), graph_.max_norm(u.edge));
+    const double arg = random_.Get(-M_PI, +M_PI);
+    return pose[u.v] + std::polar(std::sqrt(norm), arg);
+}
+
+std::optional<Complex> Poser::LocateDeg2(const Pose& pose, const Arc& u, const Arc& t)
+{
+    POSER_COUNT(++stats_.locate_deg2);
+    const double rt_sq = random_.Get(graph_.min_norm(t.edge), graph_.max_norm(t.edge));
+    const double ru_sq = random_.Get(graph_.min_norm(u.edge), graph_.max_norm(u.edge));
+
+    const Intersections zs = GetIntersections(
+        Circle{pose[t.v], std::sqrt(rt_sq)}, Circle{pose[u.v], std::sqrt(ru_sq)});
+    POSER_COUNT(stats_.locate_deg2_none += zs.empty());
+    if (zs.empty()) return std::nullopt;
+
+    return (random_.Bernoulli(0.5)) ? zs.front() : zs.back();
+}
+
+std::optional<Complex> Poser::Locate(const Pose& pose, int v)
+{
+    if (random_.Bernoulli(cfg_.prob_hole)) {
+        const std::optional<Complex> z = LocateHole(pose, v);
+        if (z.has_value()) return z;
+    }
+
+    const Arc* adj = nullptr;
+
+    for (const Arc& u : preds(v)) {
+        if (adj == nullptr) {
+            adj = &u;
+        } else {
+            if (pose[u.v] != pose[adj->v]) return LocateDeg2(pose, u, *adj);
+        }
+    }
+    return (adj == nullptr) ? LocateDeg0(pose, v) : LocateDeg1(pose, *adj);
+}
+
+// Depth-first over order_, with the stack in frames_ rather than on the call
+// stack, so that large figures go as deep as they need.
+bool Poser::Search(Pose& pose, int index)
+{
+    if (index == order_.size()) {
+        return true;
+    }
+
+    frames_.clear();
+    Enter(index);
+
+    while (!frames_.empty()) {
+        Frame& frame = frames_.back();
+        if (frame.placed) Retreat(frame);
+
+        const std::optional<int> next = (frame.chain != -1)
+            ? AdvanceChain(pose, frame) : Advance(pose, frame);
+        if (!next.has_value()) {
+            frames_.pop_back();
+            continue;
+        }
+
+        if (*next == order_.size()) return true;
+        Enter(*next);
+    }
+
+    return false;
+}
+
+void Poser::Enter(int index)
+{
+    frames_.push_back({index, chain_at_[index], 0, false});
+    tried_[index].clear();
+}
+
+// Places the vertex at the next position feasible and not tried yet, and
+// returns the index to go on with.
+std::optional<int> Poser::Advance(Pose& pose, Frame& frame)
+{
+    const int index = frame.index;
+    const int v = order_[index];
+    std::vector<Complex>& tried = tried_[index];
+
+    while (frame.step++ < cfg_.max_local_steps) {
+        if (--steps_left_ < 0)
+            return std::nullopt;
+
+        const std::optional<Complex> z = Locate(pose, v);
+        if (!z.has_value()) return std::nullopt;
+
+        pose[v] = Complex(std::round(z->real()), std::round(z->imag()));
+
+        if (std::find(tried.begin(), tried.end(), pose[v]) != tried.end()) {
+            POSER_COUNT(++stats_.reject_duplicate);
+            POSER_TRACE_EVENT(TraceKind::kPlace, TraceResult::kDuplicate,
+                              index, v, pose[v].real(), pose[v].imag());
+            continue;
+        }
+        tried.push_back(pose[v]);
+
+        if (!IsFeasible(pose, pose[v], v)) {
+            POSER_TRACE_EVENT(TraceKind::kPlace, TraceResult::kInfeasible,
+                              index, v, pose[v].real(), pose[v].imag());
+            continue;
+        }
+
+        POSER_TRACE_EVENT(TraceKind::kPlace, TraceResult::kAccepted,
+                          index, v, pose[v].real(), pose[v].imag());
+        Occupy(v, pose[v]);
+        frame.placed = true;
+        return index + 1;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<int> Poser::AdvanceChain(Pose& pose, Frame& frame)
+{
+    const int index = frame.index;
+    const std::vector<int>& chain = chains_[frame.chain];
+    const int k = chain.size() - 1;
+    std::vector<Complex>& tried = tried_[index];
+
+    const auto is_tried = [&]() {
+        for (auto it = tried.begin(); it != tried.end(); it += k - 1) {
+            if (std::equal(it, it + (k - 1), chain.begin() + 1,
+                           [&](Complex z, int v) { return z == pose[v]; }))
+                return true;
+        }
+        return false;
+    };
+
+    while (frame.step++ < cfg_.max_local_steps) {
+        if (--steps_left_ < 0)
+            return std::nullopt;
+
+        switch (chain_solver_.Place(chain, pose, random_.rng(), cfg_.prob_hole)) {
+            case ChainSolver::Result::kPlaced: {
+                POSER_COUNT(++stats_.chain_placed);
+                break;
+            }
+            case ChainSolver::Result::kUnreachable: {
+                POSER_COUNT(++stats_.chain_unreachable);
+                return std::nullopt;
+            }
+            case ChainSolver::Result::kTooExpensive: {
+                POSER_COUNT(++stats_.chain_too_expensive);
+                // Fall back to placing the vertices one by one.
+                chain_at_[index] = -1;
+                frame = {index, -1, 0, false};
+                tried.clear();
+                return Advance(pose, frame);
+            }
+        }
+
+        if (is_tried()) {
+            POSER_COUNT(++stats_.chain_duplicate);
+            continue;
+        }
+        for (int i = 1; i < k; i++) tried.push_back(pose[chain[i]]);
+
+        for (int i = 1; i < k; i++) {
+            POSER_TRACE_EVENT(TraceKind::kPlace, TraceResult::kAccepted,
+                              index + i - 1, chain[i],
+                              pose[chain[i]].real(), pose[chain[i]].imag());
+            Occupy(chain[i], pose[chain[i]]);
+        }
+        frame.placed = true;
+        return index + k - 1;
+    }
+
+    return std::nullopt;
+}
+
+// Takes back what the frame placed, after the search failed beyond it.
+void Poser::Retreat(Frame& frame)
+{
+    frame.placed = false;
+
+    if (frame.chain == -1) {
+        const int v = order_[frame.index];
+        Vacate(v);
+        POSER_COUNT(++stats_.backtracks[frame.index]);
+        POSER_TRACE_EVENT(TraceKind::kBacktrack, TraceResult::kNone, frame.index, v);
+        return;
+    }
+
+    const std::vector<int>& chain = chains_[frame.chain];
+    const int k = chain.size() - 1;
+    for (int i = 1; i < k; i++) {
+        Vacate(chain[i]);
+        POSER_TRACE_EVENT(TraceKind::kBacktrack, TraceResult::kNone,
+                          frame.index + i - 1, chain[i]);
+    }
+    POSER_COUNT(++stats_.backtracks[frame.index]);
+}
+
+bool Poser::PolishVertices(Pose& pose)
+{
+    const Hole& hole = prob_.hole();
+    const int n = pose.size();
+    const int r = cfg_.polish_radius;
+
+    // The nearest and the second nearest vertices to each hole vertex.
+    std::vector<std::pair<double, int>> first(hole.size()), second(hole.size());
+
+    const auto update = [&]() {
+        for (int h = 0; h < hole.size(); h++) {
+            first[h] = second[h] = {kInf, -1};
+            for (int v = 0; v < n; v++) {
+                const std::pair<double, int> d = {std::norm(hole[h] - pose[v]), v};
+                if (d < first[h]) second[h] = first[h], first[h] = d;
+                else if (d < second[h]) second[h] = d;
+            }
+        }
+    };
+
+    // Dislikes with v moved to z, relative to the current ones.
+    const auto gain = [&](int v, Complex z) {
+        double delta = 0.0;
+        for (int h = 0; h < hole.size(); h++) {
+            const double rest =
+                (first[h].second == v) ? second[h].first : first[h].first;
+            delta += std::min(rest, std::norm(hole[h] - z)) - first[h].first;
+        }
+        return delta;
+    };
+
+    std::vector<int> at(n);
+    for (int v = 0; v < n; v++) at[v] = hole_table_.Find(pose[v]);
+
+    const auto is_valid = [&](int v, Complex z, const std::vector<int>& skip) {
+        const Arcs adj = graph_.arcs(v);
+        return std::all_of(adj.begin(), adj.end(), [&](const Arc& arc) {
+            const auto [u, e] = arc;
+            if (std::find(skip.begin(), skip.end(), u) != skip.end()) return true;
+            return graph_.IsValidNorm(e, std::norm(pose[u] - z))
+                && hole.Contains(LineSeg{pose[u], z});
+        });
+    };
+
+    std::vector<int> order(n);
+    for (int v = 0; v < n; v++) order[v] = v;
+    std::shuffle(order.begin(), order.end(), random_.rng());
+
+    bool improved = false;
+    update();
+
+    for (const int v : order) {
+        double best_delta = 0.0;
+        Complex best_z = pose[v];
+
+        // Hole vertices, checked by the table against the neighbors on the
+        // hole vertices.
+        HoleSet candidates = HoleSet::Full(hole.size());
+        std::vector<int> on_hole;
+        for (const auto [u, e] : graph_.arcs(v)) {
+            if (at[u] == -1) continue;
+            candidates &= hole_table_.Get(e, at[u]);
+            on_hole.push_back(u);
+        }
+        candidates.ForEach([&](int i) {
+            if (!is_valid(v, hole[i], on_hole)) return;
+            const double delta = gain(v, hole[i]);
+            if (delta < best_delta) best_delta = delta, best_z = hole[i];
+        });
+
+        for (int dy = -r; dy <= r; dy++)
+        for (int dx = -r; dx <= r; dx++) {
+            const Complex z = pose[v] + Complex(dx, dy);
+            if (z == pose[v] || !is_valid(v, z, {})) continue;
+            const double delta = gain(v, z);
+            if (delta < best_delta) best_delta = delta, best_z = z;
+        }
+
+        if (best_delta < 0.0) {
+            pose[v] = best_z;
+            at[v] = hole_table_.Find(best_z);
+            update();
+            improved = true;
+        }
+    }
+
+    return improved;
+}
+
+bool Poser::PolishTranslation(Pose& pose)
+{
+    const int r = cfg_.polish_radius;
+
+    long best_dislikes = Dislikes(prob_, pose);
+    Pose best_pose = pose;
+
+    for (int dy = -r; dy <= r; dy++)
+    for (int dx = -r; dx <= r; dx++) {
+        Pose moved = pose;
+        for (Complex& z : moved) z += Complex(dx, dy);
+        const long dislikes = Dislikes(prob_, moved);
+        if (dislikes < best_dislikes && Validate(prob_, moved)) {
+            best_dislikes = dislikes;
+            best_pose = std::move(moved);
+        }
+    }
+
+    if (best_pose == pose) return false;
+    pose = std::move(best_pose);
+    return true;
+}
+
+Pose Poser::Polish(Pose pose)
+{
+    while (PolishVertices(pose) || PolishTranslation(pose))
+        continue;
+    return pose;
+}
+
+#endif  // YUIZUMI_POSER_H_
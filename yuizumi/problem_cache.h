@@ -0,0 +1,184 @@
+#ifndef YUIZUMI_PROBLEM_CACHE_H_
+#define YUIZUMI_PROBLEM_CACHE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "v2.h"
+
+// A cache file holds a problem parsed, with the grid of its hole computed.
+// The file is mapped read-only, so the processes reading the same file share
+// its pages, and the grid is used right where it is mapped.
+//
+// Layout, in the native byte order:
+//
+//   ProblemCacheHeader
+//   int32_t hole[num_hole][2]
+//   int32_t vertices[num_vertices][2]
+//   int32_t edges[num_edges][2]
+//   char grid[grid_size]
+
+constexpr char kProblemCacheMagic[8] = {'P', 'R', 'O', 'B', 'L', 'E', 'M', '\0'};
+constexpr uint32_t kProblemCacheVersion = 1;
+
+struct ProblemCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    int32_t epsilon;
+    int32_t num_hole;
+    int32_t num_vertices;
+    int32_t num_edges;
+    int32_t grid_size;
+};
+
+
+//------------------------
+//  Writer
+
+namespace impl {
+void WriteInt32Pairs(std::ofstream& out, const std::vector<Complex>& points)
+{
+    for (const Complex z : points) {
+        const int32_t xy[2] = {static_cast<int32_t>(z.real()),
+                               static_cast<int32_t>(z.imag())};
+        out.write(reinterpret_cast<const char*>(xy), sizeof(xy));
+    }
+}
+}  // namespace impl
+
+bool WriteProblemCache(const Problem& prob, const std::string& filename)
+{
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) return false;
+
+    ProblemCacheHeader header;
+    std::memcpy(header.magic, kProblemCacheMagic, sizeof(header.magic));
+    header.version = kProblemCacheVersion;
+    header.epsilon = prob.epsilon();
+    header.num_hole = prob.hole().size();
+    header.num_vertices = prob.vertices().size();
+    header.num_edges = prob.edges().size();
+    header.grid_size = prob.hole().grid_size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    impl::WriteInt32Pairs(out, prob.hole().vertices());
+    impl::WriteInt32Pairs(out, prob.vertices());
+    for (const Edge& e : prob.edges()) {
+        const int32_t uv[2] = {e.u, e.v};
+        out.write(reinterpret_cast<const char*>(uv), sizeof(uv));
+    }
+    out.write(prob.hole().grid(), header.grid_size);
+
+    return static_cast<bool>(out);
+}
+
+
+//------------------------
+//  Reader
+
+// Owns the mapping the problem refers to.
+class MappedProblem
+{
+public:
+    MappedProblem(void* data, size_t size) : data_(data), size_(size) {}
+    ~MappedProblem() { munmap(data_, size_); }
+
+    MappedProblem(const MappedProblem&) = delete;
+    MappedProblem& operator=(const MappedProblem&) = delete;
+
+    std::unique_ptr<const Problem> prob;
+
+private:
+    void* data_;
+    size_t size_;
+};
+
+namespace impl {
+std::vector<Complex> ReadInt32Pairs(const int32_t* data, int size)
+{
+    std::vector<Complex> points(size);
+    for (int i = 0; i < size; i++) points[i] = Complex(data[2 * i], data[2 * i + 1]);
+    return points;
+}
+}  // namespace impl
+
+namespace impl {
+bool IsNewer(const struct stat& st1, const struct stat& st2)
+{
+    if (st1.st_mtim.tv_sec != st2.st_mtim.tv_sec)
+        return st1.st_mtim.tv_sec > st2.st_mtim.tv_sec;
+    return st1.st_mtim.tv_nsec > st2.st_mtim.tv_nsec;
+}
+}  // namespace impl
+
+// Returns nullptr if the file is missing, older than the source (the problem
+// it was built from), or not a cache of this version which fits its hole.
+std::shared_ptr<const Problem> LoadProblemCache(const std::string& filename,
+                                                const std::string& source)
+{
+    struct stat source_st;
+    if (stat(source.c_str(), &source_st) != 0) return nullptr;
+
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= sizeof(ProblemCacheHeader)
+        && !impl::IsNewer(source_st, st))
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return nullptr;
+
+    const auto mapped = std::make_shared<MappedProblem>(data, st.st_size);
+
+    const auto& header = *static_cast<const ProblemCacheHeader*>(data);
+    if (std::memcmp(header.magic, kProblemCacheMagic, sizeof(header.magic)) != 0
+        || header.version != kProblemCacheVersion)
+        return nullptr;
+
+    if (header.num_hole < 3 || header.num_vertices < 0 || header.num_edges < 0
+        || header.grid_size < 0)
+        return nullptr;
+
+    // Checked before any pointer goes past the mapping.
+    const size_t num_ints = 2 * (size_t{0} + header.num_hole + header.num_vertices
+                                 + header.num_edges);
+    if (sizeof(header) + num_ints * sizeof(int32_t) + header.grid_size
+        != static_cast<size_t>(st.st_size))
+        return nullptr;
+
+    const int32_t* hole = reinterpret_cast<const int32_t*>(&header + 1);
+    const int32_t* vertices = hole + 2 * header.num_hole;
+    const int32_t* edges = vertices + 2 * header.num_vertices;
+    const char* grid = reinterpret_cast<const char*>(edges + 2 * header.num_edges);
+
+    Figure figure;
+    figure.vertices = impl::ReadInt32Pairs(vertices, header.num_vertices);
+    figure.edges.resize(header.num_edges);
+    for (int k = 0; k < header.num_edges; k++) {
+        figure.edges[k] = {edges[2 * k], edges[2 * k + 1]};
+        const Edge& e = figure.edges[k];
+        if (e.u < 0 || e.u >= header.num_vertices || e.v < 0 || e.v >= header.num_vertices)
+            return nullptr;
+    }
+
+    mapped->prob.reset(new Problem(impl::ReadInt32Pairs(hole, header.num_hole),
+                                   grid, std::move(figure), header.epsilon));
+
+    // The grid must be the one of this hole, or GetState reads past it.
+    if (mapped->prob->hole().grid_size() != header.grid_size) return nullptr;
+
+    // Shares the ownership of the mapping.
+    return std::shared_ptr<const Problem>(mapped, mapped->prob.get());
+}
+
+#endif  // YUIZUMI_PROBLEM_CACHE_H_
@@ -1,10 +1,12 @@
 #include <algorithm>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <optional>
 #include <random>
 #include <vector>
 #include "v1.h"
+#include "bench.h"
 
 namespace {
 
@@ -40,7 +42,8 @@ bool Intersects(const Polygon& hole, const LineSegment& line)
 class Poser
 {
 public:
-    explicit Poser(const Problem* prob);
+    explicit Poser(const Problem* prob,
+                   uint_fast32_t seed = mt19937::default_seed);
 
     optional<Pose> MakePose() {
         Pose pose(prob_.vertices().size());
@@ -77,8 +80,9 @@ private:
 };
 
 // TODO: Initialize rng_ with std::random_device?
-Poser::Poser(const Problem* prob)
+Poser::Poser(const Problem* prob, uint_fast32_t seed)
     : prob_(*prob),
+      rng_(seed),
       eps_chooser_(1.0 - prob_.epsilon() / kEpsDenom,
                    1.0 + prob_.epsilon() / kEpsDenom),
       arg_chooser_(-M_PI, +M_PI)
@@ -244,10 +248,29 @@ optional<Pose> Solve(const Problem& prob)
     return best_pose;
 }
 
+// See bench.h.
+MakePoseFunc LoadForBenchmark(istream& in, uint32_t seed)
+{
+    Json json;
+    in >> json;
+    const shared_ptr<const Problem> prob(new Problem(Problem::FromJson(json)));
+    const auto poser = make_shared<Poser>(prob.get(), seed);
+    return [prob, poser]() -> optional<long> {
+        const optional<Pose> pose = poser->MakePose();
+        if (!pose.has_value()) return nullopt;
+        return Evaluate(*prob, *pose);
+    };
+}
+
 }  // namespace
 
-int main()
+int main(int argc, char* argv[])
 {
+    if (argc >= 2 && string(argv[1]) == "--bench") {
+        return BenchmarkMain(argc - 1, argv + 1, "random_pose",
+                             LoadForBenchmark);
+    }
+
     Json json;
     cin >> json;
     const optional<Pose> pose = Solve(Problem::FromJson(json));
@@ -0,0 +1,600 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "v2.h"
+#include "chain.h"
+
+namespace {
+
+using namespace std;
+
+
+//------------------------
+//  Hint
+
+struct Hint
+{
+    int index;
+    Complex z;
+
+    static Hint FromJson(const Json& json);
+};
+
+Hint Hint::FromJson(const Json& json)
+{
+    return {
+        .index = json[0].get<int>(),
+        .z = Complex(json[1][0].get<int>(), json[1][1].get<int>()),
+    };
+}
+
+
+//------------------------
+//  Config
+
+struct Config
+{
+    vector<Hint> hints;
+
+    uint32_t seed = mt19937::default_seed;
+
+    int num_rounds = 20;
+    int max_width = 4;
+    int max_domain = 2048;
+    long max_states = 1L << 24;
+    long max_work = 10000000;
+
+    static Config FromJson(const Json& json);
+};
+
+Config Config::FromJson(const Json& json)
+{
+    Config config;
+
+    if (json.contains("hints")) {
+        config.hints.reserve(json.at("hints").size());
+        for (const Json& hint : json.at("hints"))
+            config.hints.push_back(Hint::FromJson(hint));
+    }
+
+    if (json.contains("seed")) {
+        config.seed = json.at("seed").get<uint32_t>();
+    }
+
+    if (json.contains("num_rounds")) {
+        config.num_rounds = json.at("num_rounds").get<int>();
+    }
+    if (json.contains("max_width")) {
+        config.max_width = json.at("max_width").get<int>();
+    }
+    if (json.contains("max_domain")) {
+        config.max_domain = json.at("max_domain").get<int>();
+    }
+    if (json.contains("max_states")) {
+        config.max_states = json.at("max_states").get<long>();
+    }
+    if (json.contains("max_work")) {
+        config.max_work = json.at("max_work").get<long>();
+    }
+
+    return config;
+}
+
+
+//------------------------
+//  Decomposition
+
+// Tree decomposition given by an elimination order: the bag of v consists of
+// v and scope[v], its neighbors at the time of elimination.  The parent of
+// the bag is that of the earliest eliminated vertex in scope[v].
+struct Decomposition
+{
+    vector<int> order;
+    vector<vector<int>> scope;
+    vector<vector<int>> children;
+    int width = 0;
+
+    static Decomposition Compute(int n, const vector<Edge>& edges);
+};
+
+// Eliminates the vertex of the minimum degree first.
+Decomposition Decomposition::Compute(int n, const vector<Edge>& edges)
+{
+    vector<vector<int>> adj(n);
+    for (const Edge& e : edges) {
+        adj[e.u].push_back(e.v);
+        adj[e.v].push_back(e.u);
+    }
+    for (vector<int>& a : adj) {
+        sort(a.begin(), a.end());
+        a.erase(unique(a.begin(), a.end()), a.end());
+    }
+
+    Decomposition td;
+    td.scope.resize(n);
+    td.children.resize(n);
+
+    vector<int> done(n), rank(n);
+
+    for (int i = 0; i < n; i++) {
+        int v = -1;
+        for (int u = 0; u < n; u++) {
+            if (!done[u] && (v == -1 || adj[u].size() < adj[v].size())) v = u;
+        }
+
+        td.order.push_back(v);
+        rank[v] = i;
+        done[v] = true;
+        td.scope[v] = adj[v];
+        td.width = max<int>(td.width, adj[v].size());
+
+        for (const int u : adj[v]) {
+            vector<int>& a = adj[u];
+            a.erase(find(a.begin(), a.end(), v));
+            for (const int w : adj[v]) {
+                if (w != u && !binary_search(a.begin(), a.end(), w))
+                    a.insert(lower_bound(a.begin(), a.end(), w), w);
+            }
+        }
+    }
+
+    for (const int v : td.order) {
+        if (td.scope[v].empty()) continue;
+        const int parent = *min_element(
+            td.scope[v].begin(), td.scope[v].end(),
+            [&](int u, int w) { return rank[u] < rank[w]; });
+        td.children[parent].push_back(v);
+    }
+
+    return td;
+}
+
+
+//------------------------
+//  Domains
+
+// Lattice points each vertex may be placed at.
+class Domains
+{
+public:
+    Domains(const Problem* prob, const Config* cfg);
+
+    const vector<Complex>& operator[](int v) const { return points_[v]; }
+
+    int Find(int v, Complex z) const
+    {
+        if (!member_[v].Get(z)) return -1;
+        return index_[v].at(z);
+    }
+
+private:
+    bool HasSupport(int v, int u, Complex z,
+                    const vector<Complex>& ring) const;
+
+    void Prune();
+    void Reindex(int v);
+
+    const Problem& prob_;
+
+    vector<vector<Complex>> points_;
+    vector<Lattice> member_;
+    vector<unordered_map<Complex, int>> index_;
+};
+
+Domains::Domains(const Problem* prob, const Config* cfg)
+    : prob_(*prob)
+{
+    const Hole& hole = prob_.hole();
+    const int n = prob_.vertices().size();
+
+    vector<Complex> inside;
+    for (int y = hole.ymin(); y <= hole.ymax(); y++)
+    for (int x = hole.xmin(); x <= hole.xmax(); x++) {
+        if (hole.Contains(Complex(x, y))) inside.emplace_back(x, y);
+    }
+
+    vector<optional<Complex>> hinted(n);
+    for (const Hint& hint : cfg->hints) hinted[hint.index] = hint.z;
+
+    points_.resize(n);
+    vector<int> constrained(n);
+    for (int v = 0; v < n; v++) {
+        if (!hinted[v].has_value()) continue;
+        points_[v] = {*hinted[v]};
+        constrained[v] = true;
+    }
+
+    // The neighbors of the hinted vertices are on the rings around them.
+    for (const Edge& e : prob_.edges()) {
+        for (const auto& [v, u] : {pair(e.u, e.v), pair(e.v, e.u)}) {
+            if (hinted[v].has_value() || !hinted[u].has_value()) continue;
+            const Complex zu = *hinted[u];
+            vector<Complex> points;
+            for (const Complex dz : GetRingOffsets(prob_, e)) {
+                if (!hole.Contains(LineSeg{zu, zu + dz})) continue;
+                if (!constrained[v]
+                    || find(points_[v].begin(), points_[v].end(), zu + dz) != points_[v].end())
+                    points.push_back(zu + dz);
+            }
+            points_[v] = move(points);
+            constrained[v] = true;
+        }
+    }
+
+    // Cap the domains, keeping the hole vertices which are in.
+    mt19937 rng(cfg->seed);
+
+    for (int v = 0; v < n; v++) {
+        vector<Complex>& points = points_[v];
+        if (!constrained[v]) points = inside;
+        if (points.size() > cfg->max_domain) {
+            const auto on_hole = partition(points.begin(), points.end(), [&](Complex z) {
+                return find(hole.vertices().begin(), hole.vertices().end(), z)
+                    != hole.vertices().end();
+            });
+            shuffle(on_hole, points.end(), rng);
+            points.resize(max<int>(on_hole - points.begin(), cfg->max_domain));
+        }
+    }
+
+    member_.assign(n, Lattice(hole));
+    index_.resize(n);
+    for (int v = 0; v < n; v++) Reindex(v);
+
+    Prune();
+}
+
+bool Domains::HasSupport(int v, int u, Complex z,
+                         const vector<Complex>& ring) const
+{
+    for (const Complex dz : ring) {
+        if (member_[u].Get(z + dz) && prob_.hole().Contains(LineSeg{z, z + dz}))
+            return true;
+    }
+    return false;
+}
+
+// Drops the points which have no counterpart for some edge.
+void Domains::Prune()
+{
+    const vector<Edge>& edges = prob_.edges();
+
+    vector<vector<Complex>> rings;
+    rings.reserve(edges.size());
+    for (const Edge& e : edges) rings.push_back(GetRingOffsets(prob_, e));
+
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int i = 0; i < edges.size(); i++) {
+            for (const auto& [v, u] : {pair(edges[i].u, edges[i].v),
+                                      pair(edges[i].v, edges[i].u)}) {
+                vector<Complex>& points = points_[v];
+                const auto end = remove_if(points.begin(), points.end(), [&](Complex z) {
+                    return !HasSupport(v, u, z, rings[i]);
+                });
+                if (end == points.end()) continue;
+                points.erase(end, points.end());
+                Reindex(v);
+                changed = true;
+            }
+        }
+    }
+}
+
+void Domains::Reindex(int v)
+{
+    member_[v] = Lattice(prob_.hole());
+    index_[v].clear();
+    for (int i = 0; i < points_[v].size(); i++) {
+        const Complex z = points_[v][i];
+        member_[v].Set(static_cast<int>(z.real()), static_cast<int>(z.imag()));
+        index_[v].emplace(z, i);
+    }
+}
+
+
+//------------------------
+//  TdSolver
+
+// Minimizes the sum of the unary costs over all valid poses, by dynamic
+// programming over the tree decomposition.
+class TdSolver
+{
+public:
+    TdSolver(const Problem* prob, const Config* cfg,
+             const Decomposition* td, const Domains* domains);
+
+    // cost[v] holds the hole vertices charged to v: placing v at z costs
+    // the sum of their squared distances to z.
+    optional<Pose> Solve(const vector<vector<Complex>>& cost);
+
+private:
+    struct Entry { double cost; int arg; };
+    using Table = unordered_map<uint64_t, Entry>;
+
+    bool Eliminate(int w);
+    void Enumerate(int w, int depth, double cost);
+
+    uint64_t Key(const vector<int>& scope) const;
+
+    const Problem& prob_;
+    const Config& cfg_;
+    const Decomposition& td_;
+    const Domains& domains_;
+
+    vector<vector<int>> graph_;
+    map<pair<int, int>, vector<Complex>> rings_;
+
+    // Unary costs of the current call, indexed by the domains.
+    vector<vector<double>> unary_;
+
+    // Messages from each bag to its parent, keyed by the scope.
+    vector<Table> tables_;
+    long num_states_;
+    long work_;
+
+    // Enumeration state of the current bag.
+    vector<int> vars_;
+    vector<int> assign_;
+    vector<vector<int>> ready_;
+    Table* output_;
+};
+
+TdSolver::TdSolver(const Problem* prob, const Config* cfg,
+                   const Decomposition* td, const Domains* domains)
+    : prob_(*prob), cfg_(*cfg), td_(*td), domains_(*domains),
+      graph_(prob_.vertices().size()),
+      assign_(prob_.vertices().size(), -1)
+{
+    for (const Edge& e : prob_.edges()) {
+        graph_[e.u].push_back(e.v);
+        graph_[e.v].push_back(e.u);
+        rings_.emplace(minmax(e.u, e.v), GetRingOffsets(prob_, e));
+    }
+}
+
+optional<Pose> TdSolver::Solve(const vector<vector<Complex>>& cost)
+{
+    const int n = prob_.vertices().size();
+
+    unary_.assign(n, {});
+    for (int v = 0; v < n; v++) {
+        for (const Complex z : domains_[v]) {
+            double sum = 0.0;
+            for (const Complex h : cost[v]) sum += norm(h - z);
+            unary_[v].push_back(sum);
+        }
+    }
+
+    tables_.assign(n, {});
+    num_states_ = 0;
+    work_ = 0;
+
+    for (const int w : td_.order) {
+        if (!Eliminate(w)) {
+            tables_.clear();
+            return nullopt;
+        }
+    }
+
+    Pose pose(n);
+    for (int i = n - 1; i >= 0; i--) {
+        const int w = td_.order[i];
+        const auto iter = tables_[w].find(Key(td_.scope[w]));
+        assign_[w] = iter->second.arg;
+        pose[w] = domains_[w][assign_[w]];
+    }
+
+    fill(assign_.begin(), assign_.end(), -1);
+    tables_.clear();
+    return pose;
+}
+
+uint64_t TdSolver::Key(const vector<int>& scope) const
+{
+    uint64_t key = 0;
+    for (const int v : scope) key = key * domains_[v].size() + assign_[v];
+    return key;
+}
+
+bool TdSolver::Eliminate(int w)
+{
+    // Enumerate w first, then the vertices with the most edges into those
+    // already enumerated.
+    vars_ = {w};
+    vector<int> rest = td_.scope[w];
+
+    while (!rest.empty()) {
+        const auto count = [&](int v) {
+            int c = 0;
+            for (const int u : graph_[v])
+                c += (find(vars_.begin(), vars_.end(), u) != vars_.end());
+            return c;
+        };
+        const auto next = max_element(rest.begin(), rest.end(), [&](int u, int v) {
+            const int cu = count(u), cv = count(v);
+            if (cu != cv) return cu < cv;
+            return domains_[u].size() > domains_[v].size();
+        });
+        vars_.push_back(*next);
+        rest.erase(next);
+    }
+
+    // Check each message from the children once its scope is enumerated.
+    ready_.assign(vars_.size(), {});
+    for (const int c : td_.children[w]) {
+        int depth = 0;
+        for (const int v : td_.scope[c]) {
+            depth = max<int>(depth, find(vars_.begin(), vars_.end(), v) - vars_.begin());
+        }
+        ready_[depth].push_back(c);
+    }
+
+    output_ = &tables_[w];
+    Enumerate(w, 0, 0.0);
+
+    num_states_ += tables_[w].size();
+
+    return !tables_[w].empty()
+        && num_states_ <= cfg_.max_states && work_ <= cfg_.max_work;
+}
+
+void TdSolver::Enumerate(int w, int depth, double cost)
+{
+    if (depth == vars_.size()) {
+        const uint64_t key = Key(td_.scope[w]);
+        const auto [iter, inserted] = output_->emplace(key, Entry{cost, assign_[w]});
+        if (!inserted && cost < iter->second.cost) iter->second = {cost, assign_[w]};
+        return;
+    }
+
+    if (output_->size() + num_states_ > cfg_.max_states) return;
+    if (work_ > cfg_.max_work) return;
+
+    const int v = vars_[depth];
+    const vector<Complex>& domain = domains_[v];
+
+    int anchor = -1;
+    for (int d = 0; d < depth; d++) {
+        if (find(graph_[v].begin(), graph_[v].end(), vars_[d]) != graph_[v].end()) {
+            anchor = vars_[d];
+            break;
+        }
+    }
+
+    const auto visit = [&](int i) {
+        ++work_;
+        const Complex z = domain[i];
+        for (int d = 0; d < depth; d++) {
+            const int u = vars_[d];
+            if (find(graph_[v].begin(), graph_[v].end(), u) == graph_[v].end())
+                continue;
+            const Complex zu = domains_[u][assign_[u]];
+            if (!prob_.IsValidNorm(Edge{u, v}, norm(zu - z))) return;
+            if (!prob_.hole().Contains(LineSeg{zu, z})) return;
+        }
+
+        assign_[v] = i;
+
+        double sum = cost + ((v == w) ? unary_[w][i] : 0.0);
+        for (const int c : ready_[depth]) {
+            const auto iter = tables_[c].find(Key(td_.scope[c]));
+            if (iter == tables_[c].end()) { assign_[v] = -1; return; }
+            sum += iter->second.cost;
+        }
+
+        Enumerate(w, depth + 1, sum);
+        assign_[v] = -1;
+    };
+
+    if (anchor == -1) {
+        for (int i = 0; i < domain.size(); i++) visit(i);
+    } else {
+        const Complex za = domains_[anchor][assign_[anchor]];
+        for (const Complex dz : rings_.at(minmax(anchor, v))) {
+            const int i = domains_.Find(v, za + dz);
+            if (i != -1) visit(i);
+        }
+    }
+}
+
+
+//------------------------
+//  Solve
+
+// Dislikes are not a sum over bags, but they are the minimum over all the
+// ways to charge each hole vertex to a figure vertex.  Alternate between
+// an exact solve for the charges and recharging to the nearest vertices.
+optional<Pose> Solve(const Problem& prob, const Config& cfg)
+{
+    const int n = prob.vertices().size();
+    const Decomposition td = Decomposition::Compute(n, prob.edges());
+
+    cerr << "width = " << td.width << endl;
+    if (td.width > cfg.max_width) return nullopt;
+
+    const Domains domains(&prob, &cfg);
+
+    for (int v = 0; v < n; v++) {
+        if (domains[v].empty()) return nullopt;
+    }
+
+    // Each key must fit into 64 bits.
+    for (int v = 0; v < n; v++) {
+        double bits = 0.0;
+        for (const int u : td.scope[v]) bits += log2(domains[u].size());
+        if (bits >= 64.0) return nullopt;
+    }
+
+    TdSolver solver(&prob, &cfg, &td, &domains);
+    mt19937 rng(cfg.seed);
+
+    long best_dislikes = numeric_limits<long>::max();
+    optional<Pose> best_pose;
+
+    vector<vector<Complex>> cost(n);
+    long last_dislikes = numeric_limits<long>::max();
+
+    for (int i = 1; i <= cfg.num_rounds; i++) {
+        const optional<Pose> pose = solver.Solve(cost);
+        if (!pose.has_value()) {
+            cerr << "(no pose within max_states / max_work)" << endl;
+            break;
+        }
+
+        const long dislikes = Dislikes(prob, *pose);
+        if (dislikes < best_dislikes) {
+            cerr << "[" << i << ":" << dislikes << "]";
+            best_dislikes = dislikes;
+            best_pose = pose;
+        }
+        if (dislikes == 0) break;
+
+        for (vector<Complex>& c : cost) c.clear();
+
+        if (dislikes < last_dislikes) {
+            for (const Complex h : prob.hole().vertices()) {
+                int nearest = 0;
+                for (int v = 1; v < n; v++) {
+                    if (norm(h - (*pose)[v]) < norm(h - (*pose)[nearest])) nearest = v;
+                }
+                cost[nearest].push_back(h);
+            }
+        } else {
+            // Converged; restart from random charges.
+            uniform_int_distribution<int> chooser(0, n - 1);
+            for (const Complex h : prob.hole().vertices())
+                cost[chooser(rng)].push_back(h);
+        }
+        last_dislikes = dislikes;
+
+        cerr << ".";
+    }
+    cerr << endl;
+    return best_pose;
+}
+
+}  // namespace
+
+//------------------------
+//  Entrypoint
+
+int main(int argc, char* argv[])
+{
+    Config cfg;
+
+    if (argc >= 2) cfg = Config::FromJson(Json::parse(argv[1]));
+    Json json;
+    cin >> json;
+    const optional<Pose> pose = Solve(Problem::FromJson(json), cfg);
+    if (pose.has_value()) cout << PoseToJson(*pose) << endl;
+
+    return 0;
+}
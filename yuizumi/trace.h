@@ -0,0 +1,118 @@
+#ifndef YUIZUMI_TRACE_H_
+#define YUIZUMI_TRACE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Events of the search, kept in a ring buffer owned by each Poser (thus by
+// one thread, with no locks) and dumped into a binary file:
+//
+//   TraceHeader
+//   TraceEvent events[num_events]   // the oldest first
+//
+// trace_to_json converts the file into JSON.
+
+
+//------------------------
+//  TraceEvent
+
+enum class TraceKind : uint8_t
+{
+    kBegin = 0,      // MakePose started, from the depth.
+    kPlace = 1,      // The vertex was tried at (x, y).
+    kBacktrack = 2,  // The vertex was taken back.
+    kEnd = 3,        // MakePose ended.
+};
+
+enum class TraceResult : uint8_t
+{
+    kNone = 0,
+    kAccepted = 1,
+    kDuplicate = 2,
+    kInfeasible = 3,
+    kMade = 4,
+    kFailed = 5,
+};
+
+struct TraceEvent
+{
+    TraceKind kind;
+    TraceResult result;
+    uint16_t depth;
+    uint16_t vertex;
+    int16_t x, y;
+};
+
+constexpr char kTraceMagic[8] = {'P', 'T', 'R', 'A', 'C', 'E', '\0', '\0'};
+constexpr uint32_t kTraceVersion = 1;
+
+struct TraceHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t event_size;
+    // Including those overwritten in the ring.
+    uint64_t total_events;
+    uint64_t num_events;
+};
+
+
+//------------------------
+//  TraceBuffer
+
+class TraceBuffer
+{
+public:
+    // Keeps the last 2^log2_capacity events.
+    explicit TraceBuffer(int log2_capacity = 20)
+        : events_(size_t{1} << log2_capacity),
+          mask_(events_.size() - 1) {}
+
+    void Record(TraceKind kind, TraceResult result, int depth, int vertex,
+                int x = 0, int y = 0)
+    {
+        events_[total_++ & mask_] = {
+            kind, result,
+            static_cast<uint16_t>(depth), static_cast<uint16_t>(vertex),
+            static_cast<int16_t>(x), static_cast<int16_t>(y)};
+    }
+
+    bool Dump(const std::string& filename) const;
+
+private:
+    std::vector<TraceEvent> events_;
+    uint64_t mask_;
+    uint64_t total_ = 0;
+};
+
+bool TraceBuffer::Dump(const std::string& filename) const
+{
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) return false;
+
+    const uint64_t n = std::min<uint64_t>(total_, events_.size());
+
+    TraceHeader header;
+    std::memcpy(header.magic, kTraceMagic, sizeof(header.magic));
+    header.version = kTraceVersion;
+    header.event_size = sizeof(TraceEvent);
+    header.total_events = total_;
+    header.num_events = n;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // The ring from the oldest event, in at most two pieces.
+    const uint64_t start = (total_ - n) & mask_;
+    const uint64_t first = std::min<uint64_t>(n, events_.size() - start);
+    out.write(reinterpret_cast<const char*>(&events_[start]),
+              first * sizeof(TraceEvent));
+    out.write(reinterpret_cast<const char*>(&events_[0]),
+              (n - first) * sizeof(TraceEvent));
+
+    return static_cast<bool>(out);
+}
+
+#endif  // YUIZUMI_TRACE_H_
@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "trace.h"
+
+namespace {
+
+const char* KindName(TraceKind kind)
+{
+    switch (kind) {
+        case TraceKind::kBegin: return "begin";
+        case TraceKind::kPlace: return "place";
+        case TraceKind::kBacktrack: return "backtrack";
+        case TraceKind::kEnd: return "end";
+    }
+    return "unknown";
+}
+
+const char* ResultName(TraceResult result)
+{
+    switch (result) {
+        case TraceResult::kNone: return nullptr;
+        case TraceResult::kAccepted: return "accepted";
+        case TraceResult::kDuplicate: return "duplicate";
+        case TraceResult::kInfeasible: return "infeasible";
+        case TraceResult::kMade: return "made";
+        case TraceResult::kFailed: return "failed";
+    }
+    return "unknown";
+}
+
+}  // namespace
+
+// Prints the last LIMIT events (or all) of the trace as a JSON object.
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: trace_to_json TRACE [LIMIT]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream fin(argv[1], std::ios::binary);
+    TraceHeader header;
+    if (!fin.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, kTraceMagic, sizeof(header.magic)) != 0
+        || header.version != kTraceVersion
+        || header.event_size != sizeof(TraceEvent)) {
+        std::cerr << argv[1] << ": not a trace of this version" << std::endl;
+        return 1;
+    }
+
+    uint64_t skip = 0;
+    if (argc >= 3) {
+        const uint64_t limit = std::strtoull(argv[2], nullptr, 10);
+        if (limit < header.num_events) skip = header.num_events - limit;
+    }
+
+    std::vector<TraceEvent> events(header.num_events);
+    fin.read(reinterpret_cast<char*>(events.data()),
+             events.size() * sizeof(TraceEvent));
+    if (!fin) {
+        std::cerr << argv[1] << ": truncated" << std::endl;
+        return 1;
+    }
+
+    // The index of the first event printed, counting those lost in the ring.
+    const uint64_t first = header.total_events - header.num_events + skip;
+    printf("{\"total_events\":%llu,\"first\":%llu,\"events\":[",
+           static_cast<unsigned long long>(header.total_events),
+           static_cast<unsigned long long>(first));
+
+    for (uint64_t i = skip; i < events.size(); i++) {
+        const TraceEvent& e = events[i];
+        printf("%s\n{\"kind\":\"%s\",\"depth\":%d",
+               (i == skip) ? "" : ",", KindName(e.kind), e.depth);
+        if (const char* result = ResultName(e.result); result != nullptr)
+            printf(",\"result\":\"%s\"", result);
+        if (e.kind == TraceKind::kPlace || e.kind == TraceKind::kBacktrack)
+            printf(",\"vertex\":%d", e.vertex);
+        if (e.kind == TraceKind::kPlace)
+            printf(",\"z\":[%d,%d]", e.x, e.y);
+        printf("}");
+    }
+    printf("\n]}\n");
+
+    return 0;
+}
@@ -95,8 +95,30 @@ inline IntersectsResult Intersects(const LineSeg& l, const LineSeg& m)
 
 struct Circle { Complex z; double r; };
 
-inline std::vector<Complex> GetIntersections(const Circle& c1,
-                                             const Circle& c2)
+// Up to two points, held without allocation.
+class Intersections
+{
+public:
+    Intersections() = default;
+    Intersections(Complex z) : zs_{z}, size_(1) {}
+    Intersections(Complex z1, Complex z2) : zs_{z1, z2}, size_(2) {}
+
+    int size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    Complex operator[](int i) const { return zs_[i]; }
+    Complex front() const { return zs_[0]; }
+    Complex back() const { return zs_[size_ - 1]; }
+
+    const Complex* begin() const { return zs_; }
+    const Complex* end() const { return zs_ + size_; }
+
+private:
+    Complex zs_[2];
+    int size_ = 0;
+};
+
+inline Intersections GetIntersections(const Circle& c1, const Circle& c2)
 {
     const Complex dz = c2.z - c1.z;
 
@@ -125,6 +147,11 @@ class Hole
 public:
     explicit Hole(std::vector<Complex> vertices);
 
+    // Uses the given grid instead of computing it: laid out as grid(), of
+    // grid_size() for these vertices, and outliving this hole (e.g. mapped
+    // from a cache file; see problem_cache.h).
+    Hole(std::vector<Complex> vertices, const char* grid);
+
     Hole(const Hole&) = delete;
     Hole& operator=(const Hole&) = delete;
 
@@ -134,6 +161,10 @@ public:
 
     const std::vector<LineSeg>& borders() const { return borders_; }
 
+    // States of the grid points in the bounding box, row by row.
+    const char* grid() const { return reinterpret_cast<const char*>(state_); }
+    int grid_size() const { return x_size_ * (ymax_ - ymin_ + 1); }
+
     int xmin() const { return xmin_; }
     int ymin() const { return ymin_; }
     int xmax() const { return xmax_; }
@@ -146,19 +177,47 @@ public:
 private:
     enum class State : char { kInside, kBorder, kOutside };
 
+    void InitBounds();
+
     State ComputeState(Complex z) const;
     State GetState(Complex z) const;
 
     std::vector<Complex> vertices_;
     std::vector<LineSeg> borders_;
     int xmin_, ymin_, xmax_, ymax_;
-    std::vector<std::vector<State>> state_;
+    int x_size_;
+
+    // Points either to own_state_ or to the grid given by the caller.
+    std::vector<State> own_state_;
+    const State* state_;
 };
 
 Hole::Hole(std::vector<Complex> vertices)
-    : vertices_(std::move(vertices)),
-      borders_(vertices_.size())
+    : vertices_(std::move(vertices))
 {
+    InitBounds();
+
+    own_state_.resize(grid_size());
+
+    for (int y = ymin_; y <= ymax_; y++)
+    for (int x = xmin_; x <= xmax_; x++) {
+        const int k = (y - ymin_) * x_size_ + (x - xmin_);
+        own_state_[k] = ComputeState(Complex(x, y));
+    }
+
+    state_ = own_state_.data();
+}
+
+Hole::Hole(std::vector<Complex> vertices, const char* grid)
+    : vertices_(std::move(vertices))
+{
+    InitBounds();
+    state_ = reinterpret_cast<const State*>(grid);
+}
+
+void Hole::InitBounds()
+{
+    borders_.resize(size());
     for (int i = 0; i < size(); i++) {
         borders_[i] = {vertices_[i], vertices_[(i + 1) % size()]};
     }
@@ -176,15 +235,7 @@ Hole::Hole(std::vector<Complex> vertices)
     xmax_ = static_cast<int>(xmax);
     ymax_ = static_cast<int>(ymax);
 
-    const int x_size = xmax_ - xmin_ + 1;
-    const int y_size = ymax_ - ymin_ + 1;
-
-    state_.assign(y_size, std::vector<State>(x_size));
-
-    for (int y = ymin_; y <= ymax_; y++)
-    for (int x = xmin_; x <= xmax_; x++) {
-        state_[y - ymin_][x - xmin_] = ComputeState(Complex(x, y));
-    }
+    x_size_ = xmax_ - xmin_ + 1;
 }
 
 bool Hole::Contains(const LineSeg& line) const
@@ -196,7 +247,10 @@ bool Hole::Contains(const LineSeg& line) const
         return false;
     }
 
-    std::vector<Complex> touching;
+    // Reused across calls (by each thread, as the hole may be shared).
+    static thread_local std::vector<Complex> touching;
+    touching.clear();
+    touching.reserve(2 + 2 * borders_.size());
 
     if (q1 == State::kBorder) touching.push_back(line.z1);
     if (q2 == State::kBorder) touching.push_back(line.z2);
@@ -250,7 +304,7 @@ Hole::State Hole::GetState(Complex z) const
     const int y = static_cast<int>(z.imag());
     if (x < xmin_ || x > xmax_ || y < ymin_ || y > ymax_)
         return State::kOutside;
-    return state_[y - ymin_][x - xmin_];
+    return state_[(y - ymin_) * x_size_ + (x - xmin_)];
 }
 
 
@@ -292,6 +346,12 @@ public:
           figure_(std::move(figure)),
           epsilon_(epsilon) {}
 
+    // With the grid of the hole computed already; see Hole.
+    Problem(std::vector<Complex> hole, const char* grid, Figure figure, int epsilon)
+        : hole_(std::move(hole), grid),
+          figure_(std::move(figure)),
+          epsilon_(epsilon) {}
+
     Problem(const Problem&) = delete;
     Problem operator=(const Problem&) = delete;
 